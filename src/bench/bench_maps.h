@@ -0,0 +1,146 @@
+#pragma once
+
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "../pathing/bit_grid.h"
+
+// Synthetic walkability maps for the path benchmark. Each generator is
+// deterministic for a given seed so every backend sees the same input.
+
+enum class MapKind {
+    Open,       // open field with scattered single-tile rocks
+    Maze,       // perfect maze with 1-tile corridors
+    Islands,    // grass blobs in water, like makeTilemap but bigger
+    Corridors,  // lattice of narrow corridors with random gaps
+};
+
+constexpr MapKind MAP_KINDS[] = {
+    MapKind::Open,
+    MapKind::Maze,
+    MapKind::Islands,
+    MapKind::Corridors,
+};
+
+std::string_view mapKindName(MapKind kind) {
+    switch (kind) {
+        case MapKind::Open:
+            return "open";
+        case MapKind::Maze:
+            return "maze";
+        case MapKind::Islands:
+            return "islands";
+        case MapKind::Corridors:
+            return "corridors";
+    }
+    return "?";
+}
+
+/**** Generators ****/
+
+BitGrid openMap(Vec2I dim, std::mt19937& rng) {
+    BitGrid map(dim);
+    for (int y = 0; y < dim.y; ++y) {
+        for (int x = 0; x < dim.x; ++x) {
+            map.set({x, y}, rng() % 100 >= 10);
+        }
+    }
+    return map;
+}
+
+// Depth-first backtracker over the odd cells, carving the wall in between
+BitGrid mazeMap(Vec2I dim, std::mt19937& rng) {
+    BitGrid     map(dim);
+    const Vec2I cells = {(dim.x - 1) / 2, (dim.y - 1) / 2};
+    if (cells.x <= 0 || cells.y <= 0) {
+        return map;
+    }
+
+    std::vector<bool>  visited(cells.x * cells.y, false);
+    std::vector<Vec2I> stack = {{0, 0}};
+    visited[0]               = true;
+    map.set({1, 1}, true);
+    while (!stack.empty()) {
+        const Vec2I c = stack.back();
+        Vec2I       options[4];
+        int         n = 0;
+        for (Vec2I d : {Vec2I(0, -1), Vec2I(1, 0), Vec2I(0, 1), Vec2I(-1, 0)}) {
+            const Vec2I next = c + d;
+            if (next.x >= 0 && next.x < cells.x && next.y >= 0 &&
+                next.y < cells.y && !visited[next.y * cells.x + next.x]) {
+                options[n++] = d;
+            }
+        }
+        if (n == 0) {
+            stack.pop_back();
+            continue;
+        }
+        const Vec2I d    = options[rng() % n];
+        const Vec2I next = c + d;
+        visited[next.y * cells.x + next.x] = true;
+        map.set({2 * c.x + 1 + d.x, 2 * c.y + 1 + d.y}, true);
+        map.set({2 * next.x + 1, 2 * next.y + 1}, true);
+        stack.push_back(next);
+    }
+    return map;
+}
+
+BitGrid islandsMap(Vec2I dim, std::mt19937& rng) {
+    BitGrid   map(dim);
+    const int blobs = dim.x * dim.y / 150;
+    for (int b = 0; b < blobs; ++b) {
+        const Vec2I c = {
+            static_cast<int>(rng() % dim.x), static_cast<int>(rng() % dim.y)
+        };
+        const int r = 2 + static_cast<int>(rng() % 6);
+        for (int y = std::max(0, c.y - r); y <= std::min(dim.y - 1, c.y + r);
+             ++y) {
+            for (int x = std::max(0, c.x - r);
+                 x <= std::min(dim.x - 1, c.x + r); ++x) {
+                if ((x - c.x) * (x - c.x) + (y - c.y) * (y - c.y) <= r * r) {
+                    map.set({x, y}, true);
+                }
+            }
+        }
+    }
+    return map;
+}
+
+BitGrid corridorsMap(Vec2I dim, std::mt19937& rng) {
+    const int SPACING = 6;
+    BitGrid   map(dim);
+    for (int y = 0; y < dim.y; y += SPACING) {
+        for (int x = 0; x < dim.x; ++x) {
+            // Occasional breaks so some corridors are dead ends
+            if (rng() % 100 >= 3) {
+                map.set({x, y}, true);
+            }
+        }
+    }
+    for (int x = 0; x < dim.x; x += SPACING) {
+        for (int y0 = 0; y0 + SPACING <= dim.y; y0 += SPACING) {
+            if (rng() % 2 == 0) {
+                for (int y = y0; y <= std::min(y0 + SPACING, dim.y - 1); ++y) {
+                    map.set({x, y}, true);
+                }
+            }
+        }
+    }
+    return map;
+}
+
+BitGrid makeBenchMap(MapKind kind, Vec2I dim, uint32_t seed) {
+    std::mt19937 rng(seed);
+    switch (kind) {
+        case MapKind::Open:
+            return openMap(dim, rng);
+        case MapKind::Maze:
+            return mazeMap(dim, rng);
+        case MapKind::Islands:
+            return islandsMap(dim, rng);
+        case MapKind::Corridors:
+            return corridorsMap(dim, rng);
+    }
+    return BitGrid(dim);
+}
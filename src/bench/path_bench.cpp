@@ -0,0 +1,330 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <new>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../pathing/astar.h"
+#include "../pathing/dstar_lite.h"
+#include "../pathing/flow_field.h"
+#include "../pathing/hpa.h"
+#include "../pathing/jps.h"
+#include "../pathing/regions.h"
+#include "bench_maps.h"
+
+// Pathfinding benchmark. Every backend runs the same seeded query mixes on
+// the same synthetic maps, so numbers are comparable across backends and
+// across commits.
+//
+//   PathBench [size ...]   (default: 64 256 1024)
+
+/**** Allocation counting ****/
+
+std::atomic<uint64_t> allocatedBytes = 0;
+
+void* operator new(size_t size) {
+    allocatedBytes += size;
+    if (void* p = std::malloc(size)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+/**** Queries ****/
+
+const uint32_t MAP_SEED     = 1;
+const uint32_t QUERY_SEED   = 2;
+const int      QUERIES      = 100;
+const int      WARMUP       = 10;
+const int      SHORT_RANGE  = 20;  // tiles
+const int      MAX_ATTEMPTS = 100000;
+
+enum class Mix {
+    Short,
+    Long,
+    Unreachable,
+};
+
+struct Query {
+    int start;
+    int goal;
+};
+
+// Pairs of walkable tiles: short ones within SHORT_RANGE, long ones at least
+// half the map apart, unreachable ones on different islands. May come back
+// short (or empty) if the map has no such pairs.
+std::vector<Query> makeQueries(
+    Mix mix, GridView grid, const RegionLabels& regions, uint32_t seed
+) {
+    std::mt19937       rng(seed);
+    std::vector<Query> queries;
+
+    auto randomTile = [&]() { return static_cast<int>(rng() % grid.size()); };
+    const int longRange = std::max(grid.dim.x, grid.dim.y) / 2 * STRAIGHT_COST;
+
+    for (int attempt = 0;
+         attempt < MAX_ATTEMPTS && static_cast<int>(queries.size()) < QUERIES;
+         ++attempt) {
+        const int start = randomTile();
+        if (!grid.walkable(grid.pos(start))) {
+            continue;
+        }
+        int goal = randomTile();
+        if (mix == Mix::Short) {
+            const Vec2I s  = grid.pos(start);
+            const int   dx = static_cast<int>(rng() % (2 * SHORT_RANGE + 1));
+            const int   dy = static_cast<int>(rng() % (2 * SHORT_RANGE + 1));
+            const Vec2I g  = {
+                std::clamp(s.x + dx - SHORT_RANGE, 0, grid.dim.x - 1),
+                std::clamp(s.y + dy - SHORT_RANGE, 0, grid.dim.y - 1)
+            };
+            goal = grid.index(g);
+        }
+        if (goal == start || !grid.walkable(grid.pos(goal))) {
+            continue;
+        }
+
+        const bool reachable = regions.reachable(start, goal);
+        const int  distance  = octile(grid.pos(start), grid.pos(goal));
+        const bool wanted =
+            mix == Mix::Unreachable ? !reachable
+            : mix == Mix::Long      ? reachable && distance >= longRange
+                                    : reachable;
+        if (wanted) {
+            queries.push_back({start, goal});
+        }
+    }
+    return queries;
+}
+
+/**** Backends ****/
+
+enum class Backend {
+    AStar,
+    Jps,
+    Hpa,
+    FlowField,
+    DStarLite,
+};
+
+constexpr Backend BACKENDS[] = {
+    Backend::AStar,     Backend::Jps,       Backend::Hpa,
+    Backend::FlowField, Backend::DStarLite,
+};
+
+const char* backendName(Backend backend) {
+    switch (backend) {
+        case Backend::AStar:
+            return "astar";
+        case Backend::Jps:
+            return "jps";
+        case Backend::Hpa:
+            return "hpa";
+        case Backend::FlowField:
+            return "flow";
+        case Backend::DStarLite:
+            return "dstar";
+    }
+    return "?";
+}
+
+// Everything a backend needs for one map. Scratch objects are reused across
+// queries the same way the game reuses them.
+struct BenchContext {
+    BitGrid                 map;
+    RegionLabels            regions;
+    std::optional<HpaGraph> hierarchy;
+    FlowField               field;
+    DStarLite               planner;
+    std::vector<int>        tiles;
+
+    GridView grid() const {
+        return GridView(map);
+    }
+};
+
+// One query as the Pathfinder would run it: rejected up front if the ends
+// are on different islands, otherwise searched in full. Leaves the path in
+// `ctx.tiles` and returns the number of nodes expanded.
+uint64_t runQuery(Backend backend, BenchContext& ctx, Query q, bool& found) {
+    const GridView   grid   = ctx.grid();
+    SearchWorkspace& ws     = searchWorkspace;
+    const uint64_t   before = pathStats.nodesExpanded;
+    ctx.tiles.clear();
+    found = false;
+    if (!ctx.regions.reachable(q.start, q.goal)) {
+        return 0;
+    }
+
+    switch (backend) {
+        case Backend::AStar:
+            found = astarSearch(grid, q.start, q.goal, ws);
+            ctx.tiles.assign(ws.path.begin(), ws.path.end());
+            break;
+        case Backend::Jps:
+            found = jpsSearch(grid, q.start, q.goal, ws);
+            ctx.tiles.assign(ws.path.begin(), ws.path.end());
+            break;
+        case Backend::Hpa:
+            found =
+                ctx.hierarchy->find(grid, q.start, q.goal, INT_MAX, ctx.tiles);
+            break;
+        case Backend::FlowField: {
+            ctx.field.goals.assign(1, q.goal);
+            ctx.field.build(grid, 0);
+            Vec2I p = grid.pos(q.start);
+            while (auto next = ctx.field.next(p)) {
+                p = *next;
+                ctx.tiles.push_back(grid.index(p));
+            }
+            found = p == grid.pos(q.goal);
+            // Every reached tile was expanded once
+            return std::count_if(
+                ctx.field.dist.begin(), ctx.field.dist.end(),
+                [](int d) { return d != INT_MAX; }
+            );
+        }
+        case Backend::DStarLite: {
+            const uint64_t expanded = ctx.planner.expanded;
+            ctx.planner.init(grid, q.start, q.goal);
+            found = ctx.planner.plan(grid, ctx.tiles);
+            return ctx.planner.expanded - expanded;
+        }
+    }
+    return pathStats.nodesExpanded - before;
+}
+
+int pathCost(GridView grid, int start, const std::vector<int>& tiles) {
+    int   cost = 0;
+    Vec2I prev = grid.pos(start);
+    for (int t : tiles) {
+        cost += octile(prev, grid.pos(t));
+        prev = grid.pos(t);
+    }
+    return cost;
+}
+
+/**** Report ****/
+
+struct BenchResult {
+    int    found;
+    double queriesPerSec;
+    double nodesPerQuery;
+    double p50Us;
+    double p99Us;
+    double bytesPerQuery;
+    double meanCost;
+};
+
+BenchResult
+measure(Backend backend, BenchContext& ctx, const std::vector<Query>& queries) {
+    bool found;
+    // Let workspaces grow to the map size before we count allocations
+    for (size_t i = 0; i < std::min<size_t>(queries.size(), WARMUP); ++i) {
+        runQuery(backend, ctx, queries[i], found);
+    }
+
+    std::vector<double> latencies;
+    latencies.reserve(queries.size());
+    BenchResult    result     = {};
+    uint64_t       nodes      = 0;
+    double         totalCost  = 0;
+    double         totalUs    = 0;
+    const uint64_t bytesStart = allocatedBytes;
+    for (const Query& q : queries) {
+        const auto start = std::chrono::steady_clock::now();
+        nodes += runQuery(backend, ctx, q, found);
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const double us =
+            std::chrono::duration<double, std::micro>(elapsed).count();
+        latencies.push_back(us);
+        totalUs += us;
+        if (found) {
+            result.found += 1;
+            totalCost += pathCost(ctx.grid(), q.start, ctx.tiles);
+        }
+    }
+    const double n       = static_cast<double>(queries.size());
+    result.bytesPerQuery = (allocatedBytes - bytesStart) / n;
+
+    std::sort(latencies.begin(), latencies.end());
+    result.p50Us         = latencies[latencies.size() / 2];
+    result.p99Us         = latencies[(latencies.size() * 99) / 100];
+    result.queriesPerSec = totalUs > 0 ? n / (totalUs / 1e6) : 0;
+    result.nodesPerQuery = nodes / n;
+    result.meanCost      = result.found ? totalCost / result.found : 0;
+    return result;
+}
+
+int main(int argc, char** argv) {
+    std::vector<int> sizes;
+    for (int i = 1; i < argc; ++i) {
+        sizes.push_back(std::atoi(argv[i]));
+    }
+    if (sizes.empty()) {
+        sizes = {64, 256, 1024};
+    }
+
+    fmt::println(
+        "{:<10} {:>5} {:<12} {:<6} {:>6} {:>10} {:>10} {:>9} {:>9} {:>9} "
+        "{:>9}",
+        "map", "size", "mix", "search", "found", "queries/s", "nodes/q",
+        "p50 us", "p99 us", "bytes/q", "cost"
+    );
+    for (MapKind kind : MAP_KINDS) {
+        for (int size : sizes) {
+            BenchContext ctx;
+            ctx.map = makeBenchMap(kind, {size, size}, MAP_SEED);
+            ctx.regions.build(ctx.grid());
+            const auto start = std::chrono::steady_clock::now();
+            ctx.hierarchy    = HpaGraph::build(ctx.grid(), 16);
+            const auto elapsed = std::chrono::steady_clock::now() - start;
+            fmt::println(
+                "# {} {}x{}: {} bytes walkability, hpa build {:.1f} ms",
+                mapKindName(kind), size, size, ctx.map.bytes(),
+                std::chrono::duration<double, std::milli>(elapsed).count()
+            );
+
+            for (Mix mix : {Mix::Short, Mix::Long, Mix::Unreachable}) {
+                const char* mixName = mix == Mix::Short  ? "short"
+                                      : mix == Mix::Long ? "long"
+                                                         : "unreachable";
+                const std::vector<Query> queries =
+                    makeQueries(mix, ctx.grid(), ctx.regions, QUERY_SEED);
+                if (queries.empty()) {
+                    fmt::println(
+                        "{:<10} {:>5} {:<12} (no such pairs)",
+                        mapKindName(kind), size, mixName
+                    );
+                    continue;
+                }
+                for (Backend backend : BACKENDS) {
+                    const BenchResult r = measure(backend, ctx, queries);
+                    fmt::println(
+                        "{:<10} {:>5} {:<12} {:<6} {:>6} {:>10.0f} {:>10.1f} "
+                        "{:>9.1f} {:>9.1f} {:>9.1f} {:>9.1f}",
+                        mapKindName(kind), size, mixName, backendName(backend),
+                        fmt::format("{}/{}", r.found, queries.size()),
+                        r.queriesPerSec, r.nodesPerQuery, r.p50Us, r.p99Us,
+                        r.bytesPerQuery, r.meanCost
+                    );
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,278 @@
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include "../pathing/astar.h"
+#include "../pathing/dstar_lite.h"
+#include "../pathing/hpa.h"
+#include "../pathing/regions.h"
+#include "bench_maps.h"
+
+// Randomized checks that what the pathfinder updates in place after a tile
+// edit matches a rebuild or a fresh search. Each check flips random tiles of
+// a seeded map and compares the two as it goes. Exits non-zero if anything
+// differs.
+//
+//   PathChecks [seed]   (default: 1)
+
+const int MAP_SIZE    = 48;
+const int TRIALS      = 4;
+const int EDITS       = 400;
+const int CHECK_EVERY = 20;  // edits between comparisons
+const int QUERIES     = 5;   // per comparison
+
+int mismatches = 0;
+
+// Count a mismatch, printing only the first few
+template <typename... Args>
+void expect(bool ok, fmt::format_string<Args...> what, Args&&... args) {
+    if (!ok && mismatches++ < 10) {
+        fmt::println("  {}", fmt::format(what, std::forward<Args>(args)...));
+    }
+}
+
+/**** Maps ****/
+
+// A seeded map to edit, alternately with and without a terrain layer
+struct CheckMap {
+    BitGrid              map;
+    std::vector<uint8_t> terrain;
+    int                  minTerrain = TERRAIN_UNIT;
+    std::mt19937         rng;
+
+    CheckMap(int trial, uint32_t seed)
+        : map(makeBenchMap(
+              trial % 2 ? MapKind::Maze : MapKind::Islands,
+              {MAP_SIZE, MAP_SIZE}, seed + trial
+          ))
+        , rng(seed + trial) {
+        if (trial % 2 == 0) {
+            return;
+        }
+        terrain.resize(MAP_SIZE * MAP_SIZE);
+        for (uint8_t& weight : terrain) {
+            weight = static_cast<uint8_t>(TERRAIN_UNIT / 2 + rng() % 20);
+        }
+        minTerrain = *std::min_element(terrain.begin(), terrain.end());
+    }
+
+    GridView grid() const {
+        return GridView(
+            map, terrain.empty() ? nullptr : terrain.data(), minTerrain
+        );
+    }
+
+    // Flip a random tile and return it
+    Vec2I edit() {
+        const Vec2I p = {
+            static_cast<int>(rng() % MAP_SIZE),
+            static_cast<int>(rng() % MAP_SIZE)
+        };
+        map.set(p, !map.get(p));
+        return p;
+    }
+
+    // A random walkable tile, or -1 after a few misses
+    int walkableTile() {
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            const int i = static_cast<int>(rng() % grid().size());
+            if (grid().walkable(grid().pos(i))) {
+                return i;
+            }
+        }
+        return -1;
+    }
+};
+
+// Cost of walking `tiles` from `start`, or -1 if a step is not a legal move
+int pathCost(GridView grid, int start, const std::vector<int>& tiles) {
+    int   cost = 0;
+    Vec2I prev = grid.pos(start);
+    for (int t : tiles) {
+        const Vec2I next = grid.pos(t);
+        const Vec2I d    = next - prev;
+        if (std::abs(d.x) > 1 || std::abs(d.y) > 1 || (d.x == 0 && d.y == 0)) {
+            return -1;
+        }
+        const Dir dir = {d.x, d.y, d.x && d.y ? DIAGONAL_COST : STRAIGHT_COST};
+        if (!grid.canStep(prev, dir)) {
+            return -1;
+        }
+        cost += grid.stepCost(next, dir.cost);
+        prev = next;
+    }
+    return cost;
+}
+
+/**** Checks ****/
+
+// HpaGraph::update against HpaGraph::build: same reachability as A*, and a
+// legal full path of the same cost as the rebuilt graph's
+void checkHpa(uint32_t seed) {
+    std::vector<int> updatedPath;
+    std::vector<int> rebuiltPath;
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        CheckMap m(trial, seed);
+        HpaGraph updated = HpaGraph::build(m.grid(), 8);
+        for (int edit = 1; edit <= EDITS; ++edit) {
+            updated.update(m.grid(), m.edit());
+            if (edit % CHECK_EVERY != 0) {
+                continue;
+            }
+            const HpaGraph rebuilt = HpaGraph::build(m.grid(), 8);
+            for (int q = 0; q < QUERIES; ++q) {
+                const int s = m.walkableTile();
+                const int t = m.walkableTile();
+                if (s < 0 || t < 0) {
+                    continue;
+                }
+                const bool found =
+                    updated.find(m.grid(), s, t, INT_MAX, updatedPath);
+                const bool expected =
+                    rebuilt.find(m.grid(), s, t, INT_MAX, rebuiltPath);
+                expect(
+                    found == expected,
+                    "hpa: found {} after updates, {} rebuilt", found, expected
+                );
+                expect(
+                    found == astarSearch(m.grid(), s, t, searchWorkspace),
+                    "hpa: found {} but A* disagrees", found
+                );
+                if (!found || !expected) {
+                    continue;
+                }
+                const int  cost = pathCost(m.grid(), s, updatedPath);
+                const bool full =
+                    updatedPath.empty() ? s == t : updatedPath.back() == t;
+                expect(
+                    cost >= 0 && full,
+                    "hpa: path from {} to {} is not a legal full path", s, t
+                );
+                expect(
+                    cost == pathCost(m.grid(), s, rebuiltPath),
+                    "hpa: cost {} after updates, {} rebuilt", cost,
+                    pathCost(m.grid(), s, rebuiltPath)
+                );
+            }
+        }
+    }
+}
+
+// RegionLabels::update against RegionLabels::build: every sampled pair of
+// tiles is connected in one exactly when it is in the other
+void checkRegions(uint32_t seed) {
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        CheckMap     m(trial, seed);
+        RegionLabels updated;
+        updated.build(m.grid());
+        for (int edit = 1; edit <= EDITS; ++edit) {
+            const Vec2I p = m.edit();
+            updated.update(m.grid(), m.grid().index(p), m.map.get(p));
+            if (edit % CHECK_EVERY != 0) {
+                continue;
+            }
+            RegionLabels rebuilt;
+            rebuilt.build(m.grid());
+            const int size = m.grid().size();
+            for (int i = 0; i < size; ++i) {
+                for (int j = i; j < size; j += 37) {
+                    expect(
+                        updated.reachable(i, j) == rebuilt.reachable(i, j),
+                        "regions: {} to {} reachable {} after updates, {} "
+                        "rebuilt",
+                        i, j, updated.reachable(i, j), rebuilt.reachable(i, j)
+                    );
+                }
+            }
+        }
+    }
+}
+
+// DStarLite repairs against A* from scratch. One planner follows its own
+// path a step at a time while tiles change around it, the way a worker's
+// does in Pathfinder::replan, and after every edit its path must cost what
+// A* finds. It starts over on a new pair when its goal is cut off.
+void checkDStarLite(uint32_t seed) {
+    std::vector<int> path;
+    for (int trial = 0; trial < TRIALS; ++trial) {
+        CheckMap  m(trial, seed);
+        DStarLite planner;
+        int       start  = -1;
+        int       goal   = -1;
+        bool      active = false;
+        for (int edit = 1; edit <= EDITS; ++edit) {
+            const Vec2I p = m.edit();
+            if (active && planner.affectedBy(p)) {
+                planner.tileChanged(m.grid(), m.grid().index(p));
+            }
+            if (!active || edit % CHECK_EVERY == 0) {
+                start = m.walkableTile();
+                goal  = m.walkableTile();
+                if (start < 0 || goal < 0) {
+                    active = false;
+                    continue;
+                }
+                planner.init(m.grid(), start, goal);
+                active = true;
+            }
+
+            // Pathfinder::replan only plans between connected tiles
+            const bool reachable =
+                m.grid().walkable(m.grid().pos(start)) &&
+                astarSearch(m.grid(), start, goal, searchWorkspace);
+            if (!reachable) {
+                active = false;
+                continue;
+            }
+            const int expected =
+                pathCost(m.grid(), start, searchWorkspace.path);
+            planner.moveStart(m.grid(), start);
+            const bool found = planner.plan(m.grid(), path);
+            const int  cost  = pathCost(m.grid(), start, path);
+            expect(
+                found, "dstar: no path from {} to {}, A* found one", start, goal
+            );
+            expect(
+                !found || cost == expected,
+                "dstar: cost {} from {} to {}, A* found {}", cost, start, goal,
+                expected
+            );
+            if (found && !path.empty() && m.rng() % 2) {
+                start = path.front();
+            }
+        }
+    }
+}
+
+struct Check {
+    const char* name;
+    void (*run)(uint32_t seed);
+};
+
+const Check CHECKS[] = {
+    {"hpa update vs rebuild", checkHpa},
+    {"regions update vs rebuild", checkRegions},
+    {"dstar lite repair vs A*", checkDStarLite},
+};
+
+int main(int argc, char** argv) {
+    const uint32_t seed =
+        argc > 1 ? static_cast<uint32_t>(std::atoi(argv[1])) : 1;
+    for (const Check& check : CHECKS) {
+        const int before = mismatches;
+        check.run(seed);
+        fmt::println(
+            "{:<28} {}", check.name,
+            mismatches == before
+                ? "ok"
+                : fmt::format("{} mismatches", mismatches - before)
+        );
+    }
+    return mismatches == 0 ? 0 : 1;
+}
@@ -2,39 +2,65 @@
 
 #include <flecs.h>
 
-#include <deque>
+#include <type_traits>
+#include <utility>
 
+#include "pathing/compact_path.h"
 #include "utils/util.h"
 
 struct WorkerTag {};
 struct TreeTag {};
 struct WoodTag {};
 
-struct Targeted {};
-
 NEWTYPE(Position, Vec2I)
 NEWTYPE(Tick, int)
 NEWTYPE(Count, int)
 
+using CompactPath = BasicCompactPath<Position>;
+
+/**** Worker states ****/
+
+// Each state is its own component and a worker has exactly one of them, so
+// workers in the same state share tables and a state's system walks only
+// those. Carrying wood is a separate tag on top of the state.
+
 struct Idle {};
+struct CarryingWood {};
 
 struct MoveTo {
-    Position             target;
-    flecs::entity        tree;
-    std::deque<Position> path;
+    Position      target;
+    flecs::entity tree;
+    CompactPath   path;
+    uint32_t      revision = 0;  // Pathfinder revision `path` was planned on
 };
 
 struct ChopingTree {
     flecs::entity target;
-    int           progress;
+    int           doneAt;  // Tick the tree comes down on
 };
 
-using AiState = std::variant<Idle, MoveTo, ChopingTree>;
-struct GatherWoodBehavior {
-    AiState state;
-    bool    hasWood;
+// Waiting on an async path query; resolved at the start of the next tick
+struct PathPending {
+    uint64_t      ticket;
+    Position      target;
+    flecs::entity tree;
 };
 
+// Switch a worker to `state`, dropping whichever state it was in. Deferred
+// inside systems, so the worker changes tables once the system has run.
+template <typename State>
+void setState(flecs::entity e, State state = {}) {
+    e.remove<Idle>();
+    e.remove<MoveTo>();
+    e.remove<ChopingTree>();
+    e.remove<PathPending>();
+    if constexpr (std::is_empty_v<State>) {
+        e.add<State>();
+    } else {
+        e.set<State>(std::move(state));
+    }
+}
+
 void registerComponents(flecs::world& ecs) {
     ecs.component<Tick>();
     ecs.set(Tick(0));
@@ -43,8 +69,11 @@ void registerComponents(flecs::world& ecs) {
     ecs.component<TreeTag>();
     ecs.component<WoodTag>();
     ecs.component<Count>();
-    ecs.component<Targeted>();
-    ecs.component<GatherWoodBehavior>();
+    ecs.component<Idle>();
+    ecs.component<CarryingWood>();
+    ecs.component<MoveTo>();
+    ecs.component<ChopingTree>();
+    ecs.component<PathPending>();
 }
 
 std::ostream& operator<<(std::ostream& os, const MoveTo& moveTo) {
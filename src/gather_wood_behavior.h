@@ -2,97 +2,109 @@
 
 #include <flecs.h>
 
+#include <algorithm>
+#include <tuple>
+
 #include "components.h"
+#include "path_service.h"
 #include "pathfinder.h"
+#include "queries.h"
+#include "reservations.h"
+#include "spatial_index.h"
 #include "tilemap.h"
 #include "trees.h"
+#include "utils/log.h"
+#include "utils/profiler.h"
+#include "utils/timer_wheel.h"
 
-void handleIdle(
-    flecs::world&                           ecs,
-    const flecs::entity                     e,
-    const flecs::filter<Position, TreeTag>& trees,
-    GatherWoodBehavior&                     behavior,
-    const Position&                         pos,
-    Pathfinder&                             pathfinder,
-    std::vector<flecs::entity>&             targetedTrees
-) {
-    fmt::println("[handleIdle] Worker {} is idle. pos: {}", e.id(), pos.v);
+// Where workers drop off their wood. Homebound workers follow a shared flow
+// field toward the nearest one.
+const std::vector<Position> stockpiles = {Position(Vec2I(2, 2))};
 
-    // if have wood, return to base
-    if (behavior.hasWood) {
-        const Position base = Position(Vec2I(2, 2));
+// Ticks it takes to bring a tree down
+const int CHOP_TICKS = 3;
 
-        if (pos == base) {
-            fmt::println("[handleIdle] Worker {} returned to base", e.id());
-            spawnWood(ecs, pos);
-            behavior = GatherWoodBehavior{.state = Idle{}, .hasWood = false};
-            return;
-        }
+// Carrying workers head for the nearest stockpile and drop their wood there
+void handleDeposit(
+    flecs::world&       ecs,
+    const flecs::entity e,
+    const Position&     pos,
+    Pathfinder&         pathfinder,
+    WoodPiles&          piles
+) {
+    PROFILE_FUNCTION();
+    const FlowField& home = pathfinder.flowField(stockpiles);
+    if (!home.reachable(pos.v)) {
+        LOG(
+            Warn, Workers, "[handleDeposit] Worker {} cannot reach a base",
+            e.id()
+        );
+        return;
+    }
+    const Position base = Position(home.goalFor(pos.v));
 
-        fmt::println("[handleIdle] Worker {} has wood", e.id());
-        behavior = GatherWoodBehavior{
-            .state   = MoveTo{.target = base, .path = *pathfinder(pos, base)},
-            .hasWood = true
-        };
+    if (pos == base) {
+        LOG(
+            Debug, Workers, "[handleDeposit] Worker {} returned to base", e.id()
+        );
+        spawnWood(ecs, piles, pos);
+        e.remove<CarryingWood>();
         return;
     }
 
-    // Look for a tree to chop
-    using Tree = std::tuple<int, Position, flecs::entity>;
-    auto less  = [](const Tree& a, const Tree& b) {
-        return std::get<0>(a) < std::get<0>(b);
-    };
-    std::vector<Tree> closestTrees;
-    int               thresholdDist = INT_MAX;
-    closestTrees.reserve(100);
-
-    std::optional<AiState> nextState = std::nullopt;
-    trees.iter([&](flecs::iter& it) {
-        auto treePosArr = it.field<Position>(1);
-        for (auto i : it) {
-            flecs::entity tree    = it.entity(i);
-            Position      treePos = treePosArr[i];
-            fmt::println("[handleIdle] Tree pos: {}", treePos.v);
-
-            auto contains = [](auto& v, auto e) {
-                return std::find(v.begin(), v.end(), e) != v.end();
-            };
-            if (contains(targetedTrees, tree)) {
-                continue;
-            }
+    // Path is left empty; handleMoveTo reads each step from the field
+    LOG(Debug, Workers, "[handleDeposit] Worker {} has wood", e.id());
+    setState(e, MoveTo{.target = base});
+}
 
-            int dist = magnitude2(treePos.v - pos.v);
-            if (dist == 0) {
-                fmt::println(
-                    "[assignTasks2] Worker {} is chopping tree "
-                    "at {}",
-                    e.id(), treePos.v
-                );
-                nextState = ChopingTree{.target = tree, .progress = 0};
-                targetedTrees.push_back(tree);
-                return;
-            }
+// Idle workers without wood pick a tree. Only reads shared state, so it is
+// safe to run on several threads.
+void handleIdle(
+    flecs::world&       ecs,
+    const flecs::entity e,
+    const SpatialIndex& trees,
+    const Position&     pos,
+    int                 now,
+    const Pathfinder&   pathfinder,
+    PathService&        pathService,
+    Reservations&       reservations
+) {
+    PROFILE_FUNCTION();
+    LOG(
+        Trace, Workers, "[handleIdle] Worker {} is idle. pos: {}", e.id(), pos.v
+    );
 
-            closestTrees.push_back({dist, treePos, tree});
-        }
-    });
-    if (nextState) {
-        behavior.state = *nextState;
+    // Only checks that there is an open tree to walk to, and whether it is
+    // right here. Which one is nearest by walking distance is left to the
+    // path search, which covers every open tree at once.
+    thread_local std::vector<SpatialIndex::Entry> nearby;
+    trees.nearest(
+        pos, 1,
+        [&](const SpatialIndex::Entry& entry) {
+            return reservations.available(ecs, entry.pos, e.id()) &&
+                   pathfinder.reachable(pos, entry.pos);
+        },
+        nearby
+    );
+    if (nearby.empty()) {
         return;
     }
 
-    std::sort(closestTrees.begin(), closestTrees.end(), less);
-
-    for (const auto& [dist, treePos, tree] : closestTrees) {
-        fmt::println("[handleIdle] Tree pos: {}", treePos.v);
-        auto path = pathfinder(pos, treePos);
-        if (!path) {
-            continue;
-        }
-        behavior.state = MoveTo{.target = treePos, .tree = tree, .path = *path};
+    // Claims are taken on the main thread; see applyPathResults
+    if (nearby.front().pos == pos) {
+        const flecs::entity tree = ecs.entity(nearby.front().id);
+        LOG(
+            Debug, Workers, "[handleIdle] Worker {} is chopping tree at {}",
+            e.id(), pos.v
+        );
+        setState(e, ChopingTree{.target = tree, .doneAt = now + CHOP_TICKS});
         return;
     }
-    behavior.state = Idle{};
+
+    // Solved off-thread against the open trees of this tick (see
+    // collectOpenTrees); the worker waits in PathPending until next tick
+    const uint64_t ticket = pathService.submitNearest(e.id(), pos);
+    setState(e, PathPending{.ticket = ticket});
     return;
 }
 
@@ -100,117 +112,322 @@ void handleMoveTo(
     flecs::entity       e,
     Position&           pos,
     MoveTo&             moveTo,
-    GatherWoodBehavior& behavior,
-    const Tilemap&      map
+    const Tilemap&      map,
+    Pathfinder&         pathfinder,
+    PathService&        pathService
 ) {
-    fmt::println(
-        "[moveTo] Worker {} is moving. pos: {} moveTo: {}", e, pos.v, moveTo
+    PROFILE_FUNCTION();
+    LOG(
+        Trace, Workers, "[moveTo] Worker {} is moving. pos: {} moveTo: {}",
+        e.id(), pos.v, fmt::format("{}", moveTo)
     );
     if (moveTo.target == pos) {
-        behavior.state = Idle{};
+        setState<Idle>(e);
         return;
     }
 
-    if (moveTo.path.empty()) {
-        fmt::println(
-            "[moveTo] Worker {} path empty but not at target: {} from {}", e,
-            moveTo.target.v, pos.v
+    // Tiles changed since the path was planned. The incremental planner
+    // repairs it in place; otherwise a blocked path is dropped and queried
+    // again below.
+    if (!moveTo.path.empty() && moveTo.revision != pathfinder.revision) {
+        moveTo.revision = pathfinder.revision;
+        if (pathfinder.incremental) {
+            static std::vector<int> repaired;
+            moveTo.path =
+                pathfinder.replan(e.id(), pos, moveTo.target, repaired)
+                    ? CompactPath(pos, pathfinder.positions(repaired))
+                    : CompactPath();
+        } else if (std::any_of(
+                       moveTo.path.begin(), moveTo.path.end(),
+                       [&map](Position p) { return map[p] != Tilemap::Grass; }
+                   )) {
+            moveTo.path = CompactPath();
+        }
+    }
+
+    std::optional<Position> step;
+    if (!moveTo.path.empty()) {
+#ifndef HEADLESS
+        debugDrawer.lineStripMap(
+            moveTo.path.begin(), moveTo.path.end(),
+            [&map](Position pos) { return map.tileToWorld(pos); }
+        );
+#endif
+        step = moveTo.path.front();
+        moveTo.path.pop_front();
+    } else {
+        step = pathfinder.stepToward(pos, moveTo.target);
+    }
+
+    if (!step) {
+        // Hierarchical queries only refine the first part of a long route
+        LOG(
+            Debug, Workers,
+            "[moveTo] Worker {} path empty but not at target: {} from {}",
+            e.id(), moveTo.target.v, pos.v
+        );
+        setState(
+            e, PathPending{
+                   .ticket = pathService.submit(e.id(), pos, moveTo.target),
+                   .target = moveTo.target,
+                   .tree   = moveTo.tree
+               }
         );
         return;
     }
 
-    debugDrawer.lineStripMap(
-        moveTo.path.begin(), moveTo.path.end(),
-        [&map](Position pos) { return map.tileToWorld(pos); }
-    );
-    Position newPos = moveTo.path.front();
-    moveTo.path.pop_front();
+    Position newPos = *step;
 
     if (magnitude(newPos.v - pos.v) >= 2.f) {
-        fmt::println(
-            "[moveTo] Worker {} moved more than 1 tile: {} from {}", e,
+        LOG(
+            Error, Workers,
+            "[moveTo] Worker {} moved more than 1 tile: {} from {}", e.id(),
             newPos.v, pos.v
         );
-        fmt::println("[moveTo] MoveTo: {}", moveTo);
+        LOG(Error, Workers, "[moveTo] MoveTo: {}", fmt::format("{}", moveTo));
+        logger.flush();
         exit(1);
     }
     if (map[newPos] != Tilemap::Grass) {
-        fmt::println(
-            "[moveTo] Worker {} moved to a non-grass tile: {} from {} ", e,
+        LOG(
+            Error, Workers,
+            "[moveTo] Worker {} moved to a non-grass tile: {} from {} ", e.id(),
             newPos.v, pos.v
         );
+        logger.flush();
         exit(1);
     }
     pos = newPos;
 
     if (moveTo.target == pos) {
-        behavior.state = Idle{};
+        setState<Idle>(e);
         return;
     }
     return;
 }
 
-void handleChopingTree(
-    flecs::entity       e,
-    ChopingTree&        chopping,
-    GatherWoodBehavior& behavior,
-    const Position&     pos
-) {
-    fmt::println(
-        "[chopingTree] Worker {} is chopping tree at {}. progress: {}", e,
-        pos.v, chopping.progress
-    );
+// A chopping worker's timer fired. Timers left behind by workers that
+// stopped chopping early no longer match the worker's state and are ignored.
+void handleChopDone(flecs::entity e, int now) {
+    PROFILE_FUNCTION();
+    const ChopingTree* chopping = e.get<ChopingTree>();
+    if (!chopping || chopping->doneAt > now) {
+        return;
+    }
+    const Position& pos = *e.get<Position>();
 
-    if (!chopping.target.is_alive()) {
-        fmt::println(
-            "[chopingTree] Worker {} is dead while chopping tree at {}",
-            e, pos.v
+    if (!chopping->target.is_alive()) {
+        LOG(
+            Debug, Workers,
+            "[chopingTree] Worker {} lost its tree while chopping at {}",
+            e.id(), pos.v
         );
+        setState<Idle>(e);
         return;
-
     }
 
-    chopping.progress += 1;
-    if (chopping.progress >= 3) {
-        fmt::println("[chopingTree] Worker {} finished chopping", e);
-        chopping.target.destruct();
+    LOG(Debug, Workers, "[chopingTree] Worker {} finished chopping", e.id());
+    chopping->target.mut(e).destruct();
+    e.add<CarryingWood>();
+    setState<Idle>(e);
+}
 
-        behavior.hasWood = true;
-        behavior.state   = Idle{};
-        return;
-    }
+// Sync point for async path queries, run at the start of a tick. Results are
+// checked against the current world since trees may have gone in between.
+// A worker sent to a tree claims it here, so other idle workers stop picking
+// it while this one walks over. Results are applied in worker order, which
+// settles races for the same tree the same way on every run.
+// Tiles of the trees no live worker has claimed, the goals of this tick's
+// nearest-tree searches
+void collectOpenTrees(
+    const flecs::world& ecs,
+    const Queries&      queries,
+    const Reservations& reservations,
+    BitGrid&            open
+) {
+    PROFILE_FUNCTION();
+    open.clear();
+    queries.walkTrees([&](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            if (reservations.available(ecs, pos[i], 0)) {
+                open.set(pos[i].v, true);
+            }
+        }
+    });
 }
 
-void gatherWoodBehaviorNaive(
-    flecs::world& ecs, const Tilemap& map, Pathfinder& pathfinder
+// The tree standing on `tile`, or a null entity
+flecs::entity treeAt(
+    const flecs::world& ecs, const SpatialIndex& trees, Position tile
 ) {
-    auto workers =
-        ecs.filter_builder<Position, GatherWoodBehavior, WorkerTag>().build();
-    auto trees =
-        ecs.filter_builder<Position, TreeTag>().without<Targeted>().build();
-
-    DeferGuard                 g(ecs);
-    std::vector<flecs::entity> targetedTrees;
-    workers.each([&](flecs::entity e, Position& pos,
-                     GatherWoodBehavior& behavior, WorkerTag) {
-        std::visit(
-            match{
-                [&](Idle) {
-                    handleIdle(
-                        ecs, e, trees, behavior, pos, pathfinder, targetedTrees
-                    );
-                },
-                [&](MoveTo& moveTo) {
-                    handleMoveTo(e, pos, moveTo, behavior, map);
-                },
-                [&](ChopingTree& chopping) {
-                    handleChopingTree(e, chopping, behavior, pos);
-                },
-            },
-            behavior.state
-        );
+    flecs::entity_t id = 0;
+    trees.forEachInRadius(tile, 0, [&id](const SpatialIndex::Entry& entry) {
+        id = entry.id;
     });
-    for (auto tree : targetedTrees) {
-        tree.add<Targeted>();
+    return id ? ecs.entity(id) : flecs::entity();
+}
+
+void applyPathResults(
+    flecs::world&       ecs,
+    const Pathfinder&   pathfinder,
+    const SpatialIndex& trees,
+    PathService&        pathService,
+    Reservations&       reservations
+) {
+    PROFILE_FUNCTION();
+    static std::vector<PathResult> results;
+    pathService.drain(results);
+    // Threads finish in any order; apply by worker so table order is stable
+    std::sort(
+        results.begin(), results.end(),
+        [](const PathResult& a, const PathResult& b) {
+            return std::tie(a.owner, a.ticket) < std::tie(b.owner, b.ticket);
+        }
+    );
+
+    for (PathResult& result : results) {
+        flecs::entity e = ecs.entity(result.owner);
+        if (!e.is_alive()) {
+            continue;
+        }
+        const PathPending* pending = e.get<PathPending>();
+        if (!pending || pending->ticket != result.ticket) {
+            continue;
+        }
+
+        flecs::entity tree = result.nearest ? treeAt(ecs, trees, result.goal)
+                                            : pending->tree;
+        if (!result.found || (tree && !tree.is_alive()) ||
+            (result.nearest && !tree)) {
+            LOG(
+                Debug, Path, "[applyPathResults] Worker {} got no path", e.id()
+            );
+            setState<Idle>(e);
+            continue;
+        }
+        if (tree && !reservations.claim(ecs, result.goal, e.id())) {
+            LOG(
+                Debug, Path,
+                "[applyPathResults] Worker {} lost tree at {} to another",
+                e.id(), result.goal.v
+            );
+            setState<Idle>(e);
+            continue;
+        }
+        setState(
+            e, MoveTo{
+                   .target   = result.goal,
+                   .tree     = tree,
+                   .path     = CompactPath(
+                       *e.get<Position>(), pathfinder.positions(result.path)
+                   ),
+                   .revision = result.revision
+               }
+        );
     }
-}
\ No newline at end of file
+    pathService.recycle(results);
+}
+
+/**** Systems ****/
+
+// One system per worker state, run by ecs.progress() whenever `tick` fires.
+// Each walks only the tables of workers in its state. Choosing a tree writes
+// only the worker itself, so it runs multithreaded. Movement and deposits
+// share the pathfinder's caches and the wood piles, so they stay on the main
+// thread. Choppers sleep on `timers` and are woken in a batch on the tick
+// their tree comes down.
+void registerGatherWoodSystems(
+    flecs::world&                ecs,
+    flecs::entity                tick,
+    const Tilemap&               map,
+    const SpatialIndex&          trees,
+    Reservations&                reservations,
+    WoodPiles&                   piles,
+    TimerWheel<flecs::entity_t>& timers,
+    Pathfinder&                  pathfinder,
+    PathService&                 pathService
+) {
+    ecs.system<const Position>("ChooseTree")
+        .with<WorkerTag>()
+        .with<Idle>()
+        .without<CarryingWood>()
+        .kind(flecs::PreUpdate)
+        .tick_source(tick)
+        .multi_threaded()
+        .each([&](flecs::entity e, const Position& pos) {
+            flecs::world stage = e.world();
+            handleIdle(
+                stage, e, trees, pos, stage.get<Tick>()->v, pathfinder,
+                pathService, reservations
+            );
+        });
+
+    ecs.system<Position, MoveTo>("Move")
+        .with<WorkerTag>()
+        .kind(flecs::OnUpdate)
+        .tick_source(tick)
+        .each([&](flecs::entity e, Position& pos, MoveTo& moveTo) {
+            handleMoveTo(e, pos, moveTo, map, pathfinder, pathService);
+        });
+
+    // Workers that walked to their tree already hold its claim. This re-check
+    // settles the rest, e.g. two workers that chose a tree on their own
+    // tile: ChooseTree's deferred commands are merged one thread after
+    // another in table order, so the first in the table wins however the
+    // work was split between threads.
+    ecs.observer<const Position, const ChopingTree>()
+        .event(flecs::OnSet)
+        .each([&reservations, &timers](
+                  flecs::entity e, const Position& pos,
+                  const ChopingTree& chopping
+              ) {
+            if (!reservations.claim(e.world(), pos, e.id())) {
+                setState<Idle>(e);
+                return;
+            }
+            timers.schedule(chopping.doneAt, e.id());
+        });
+
+    // However a worker stops moving, including by being destroyed, its
+    // incremental search state goes with the MoveTo. So does its claim on
+    // the tree, unless it is standing on it and about to start chopping.
+    ecs.observer<const MoveTo>()
+        .event(flecs::OnRemove)
+        .each([&pathfinder, &reservations](
+                  flecs::entity e, const MoveTo& moveTo
+              ) {
+            pathfinder.forget(e.id());
+            const Position* pos = e.get<Position>();
+            if (moveTo.tree && !(pos && *pos == moveTo.target)) {
+                reservations.release(moveTo.target, e.id());
+            }
+        });
+
+    ecs.system("FinishChopping")
+        .kind(flecs::OnUpdate)
+        .tick_source(tick)
+        .iter([&timers](flecs::iter& it) {
+            static std::vector<TimerWheel<flecs::entity_t>::Timer> due;
+            flecs::world stage = it.world();
+            const int    now   = stage.get<Tick>()->v;
+            due.clear();
+            timers.advance(now, due);
+            for (const auto& timer : due) {
+                flecs::entity e = stage.entity(timer.item);
+                if (e.is_alive()) {
+                    handleChopDone(e, now);
+                }
+            }
+        });
+
+    ecs.system<const Position>("DepositWood")
+        .with<WorkerTag>()
+        .with<Idle>()
+        .with<CarryingWood>()
+        .kind(flecs::PostUpdate)
+        .tick_source(tick)
+        .each([&](flecs::entity e, const Position& pos) {
+            flecs::world stage = e.world();
+            handleDeposit(stage, e, pos, pathfinder, piles);
+        });
+}
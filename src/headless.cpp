@@ -0,0 +1,396 @@
+#include <flecs.h>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "bench/bench_maps.h"
+#include "replay.h"
+#include "simulation.h"
+#include "utils/log.h"
+#include "utils/profiler.h"
+
+// Runs the simulation without a window, one tick per ecs.progress() and as
+// fast as it will go, then reports throughput. Built with HEADLESS defined,
+// so nothing here needs SFML graphics or a display.
+//
+//   Headless [--size N] [--workers N] [--trees N] [--seed N] [--ticks N]
+//            [--threads N] [--record FILE | --replay FILE] [--trace FILE]
+//            [--rest 1] [--queries 1] [--edits N]
+//
+// --threads sets the flecs worker count; path queries are solved on one
+// thread fewer, so --threads 1 or 2 gives a single path thread.
+//
+// --record saves the inputs and the world hash after every tick. --replay
+// runs a recording's inputs again, on this run's thread count, and stops at
+// the first tick whose hash differs; record with --threads 1 and replay with
+// more to check that a parallel run matches the serial one. Both run the
+// simulation in lockstep.
+//
+// Built with PROFILER, the run ends with a table of per-scope timings, and
+// --trace writes the spans as a Chrome trace.
+//
+// --queries 1 walks every query in queries.h once per tick through the
+// cached queries and once through filters built per walk, as before they
+// were cached, and reports the two side by side.
+//
+// --edits N flips N random tiles between grass and water before every tick,
+// leaving stockpiles and the tiles under workers and trees alone, so moving
+// workers have to repair their paths. The edits are drawn from the seed and
+// replay with the rest of the inputs.
+//
+// --rest 1 serves the world and its metrics (see metrics.h) to the flecs
+// explorer while the run lasts.
+
+using Clock = std::chrono::steady_clock;
+
+struct HeadlessOptions {
+    int      size    = 64;
+    int      workers = 100;
+    int      trees   = 1000;
+    uint32_t seed    = 1;
+    int      ticks   = 1000;
+    int      threads = hardwareThreads();
+    std::string record;
+    std::string replay;
+    std::string trace;
+    bool        rest    = false;
+    bool        queries = false;
+    int         edits   = 0;
+};
+
+bool parseOptions(int argc, char** argv, HeadlessOptions& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view name  = argv[i];
+        const int              value = std::atoi(argv[i + 1]);
+        if (name == "--record") {
+            options.record = argv[i + 1];
+        } else if (name == "--replay") {
+            options.replay = argv[i + 1];
+        } else if (name == "--trace") {
+            options.trace = argv[i + 1];
+        } else if (name == "--rest") {
+            options.rest = value != 0;
+        } else if (name == "--queries") {
+            options.queries = value != 0;
+        } else if (name == "--edits") {
+            options.edits = value;
+        } else if (name == "--size") {
+            options.size = value;
+        } else if (name == "--workers") {
+            options.workers = value;
+        } else if (name == "--trees") {
+            options.trees = value;
+        } else if (name == "--seed") {
+            options.seed = static_cast<uint32_t>(value);
+        } else if (name == "--ticks") {
+            options.ticks = value;
+        } else if (name == "--threads") {
+            options.threads = value;
+        } else {
+            return false;
+        }
+    }
+    return argc % 2 == 1 && options.size > 3 && options.threads > 0 &&
+           options.edits >= 0 &&
+           (options.record.empty() || options.replay.empty());
+}
+
+// Everything but the thread count, which a replay is free to change
+ReplayLog::Inputs recordInputs(const HeadlessOptions& options) {
+    return {
+        {"size", options.size},
+        {"workers", options.workers},
+        {"trees", options.trees},
+        {"seed", options.seed},
+        {"ticks", options.ticks},
+        {"edits", options.edits},
+    };
+}
+
+bool applyInputs(const ReplayLog& log, HeadlessOptions& options) {
+    const auto size    = log.input("size");
+    const auto workers = log.input("workers");
+    const auto trees   = log.input("trees");
+    const auto seed    = log.input("seed");
+    const auto ticks   = log.input("ticks");
+    if (!size || !workers || !trees || !seed || !ticks) {
+        fmt::println("[applyInputs] Replay is missing an input");
+        return false;
+    }
+    options.size    = static_cast<int>(*size);
+    options.workers = static_cast<int>(*workers);
+    options.trees   = static_cast<int>(*trees);
+    options.seed    = static_cast<uint32_t>(*seed);
+    options.ticks   = static_cast<int>(
+        std::min<int64_t>(*ticks, static_cast<int64_t>(log.hashes.size()))
+    );
+    // Recordings from before --edits have none
+    options.edits = static_cast<int>(log.input("edits").value_or(0));
+    return true;
+}
+
+// Open ground with scattered water, the stockpiles kept dry
+Tilemap headlessTilemap(Vec2I dim, uint32_t seed) {
+    const BitGrid grass = makeBenchMap(MapKind::Open, dim, seed);
+
+    std::vector<Tilemap::TileType> tiles(dim.x * dim.y);
+    for (int y = 0; y < dim.y; ++y) {
+        for (int x = 0; x < dim.x; ++x) {
+            tiles[y * dim.x + x] =
+                grass.get(x, y) ? Tilemap::Grass : Tilemap::Water;
+        }
+    }
+    for (const Position& stockpile : stockpiles) {
+        tiles[stockpile.v.y * dim.x + stockpile.v.x] = Tilemap::Grass;
+    }
+    return Tilemap(dim, std::move(tiles));
+}
+
+/**** Map edits ****/
+
+// Flip `edits` random tiles between grass and water, skipping stockpiles,
+// workers and trees. Draws come from the tick's own stream, so a replay
+// makes the same edits. Returns the number of tiles flipped.
+int editTiles(Simulation& sim, int edits) {
+    if (edits == 0) {
+        return 0;
+    }
+    BitGrid kept(sim.map.dim);
+    for (const Position& stockpile : stockpiles) {
+        kept.set(stockpile.v, true);
+    }
+    auto keep = [&kept](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            kept.set(pos[i].v, true);
+        }
+    };
+    sim.queries.walkWorkers(keep);
+    sim.queries.walkTrees(keep);
+
+    Rng rng     = sim.stream(RngStream::MapEdits, sim.ecs.get<Tick>()->v);
+    int flipped = 0;
+    for (int i = 0; i < edits; ++i) {
+        const Position pos =
+            sim.map.pos(static_cast<int>(rng.below(sim.map.size())));
+        if (kept.get(pos.v)) {
+            continue;
+        }
+        const Tilemap::TileType type = sim.map.get(pos);
+        if (type != Tilemap::Grass && type != Tilemap::Water) {
+            continue;
+        }
+        sim.map.set(
+            pos, type == Tilemap::Grass ? Tilemap::Water : Tilemap::Grass
+        );
+        flipped += 1;
+    }
+    return flipped;
+}
+
+/**** Phase timing ****/
+
+struct Phase {
+    const char*     name;
+    flecs::entity_t id;
+};
+
+const std::array<Phase, 4> PHASES = {{
+    {"OnLoad", flecs::OnLoad},
+    {"PreUpdate", flecs::PreUpdate},
+    {"OnUpdate", flecs::OnUpdate},
+    {"PostUpdate", flecs::PostUpdate},
+}};
+
+// Wall time per phase, summed over ticks. A marker system registered after
+// the simulation's own runs last in each phase and books the time since the
+// previous marker, or since the start of the tick.
+struct PhaseTimes {
+    std::array<double, PHASES.size()> ms = {};
+    Clock::time_point                 mark;
+};
+
+void timePhases(flecs::world& ecs, PhaseTimes& times) {
+    for (size_t i = 0; i < PHASES.size(); ++i) {
+        ecs.system().kind(PHASES[i].id).iter([&times, i](flecs::iter&) {
+            const Clock::time_point now = Clock::now();
+            times.ms[i] +=
+                std::chrono::duration<double, std::milli>(now - times.mark)
+                    .count();
+            times.mark = now;
+        });
+    }
+}
+
+/**** Query cost ****/
+
+const std::array<QueryMode, 2> QUERY_MODES = {
+    QueryMode::Cached, QueryMode::AdHoc
+};
+
+// Walk every query once in each mode, adding the work to `totals` apart
+// from whatever the simulation walked itself
+void walkQueries(Queries& queries, std::array<QueryStats, 2>& totals) {
+    const QueryMode mode = queries.mode;
+    for (QueryMode m : QUERY_MODES) {
+        const QueryStats before = statsFor(m);
+        queries.mode            = m;
+        queries.walkWorkers([](flecs::iter&, const Position*) {});
+        queries.walkTrees([](flecs::iter&, const Position*) {});
+        queries.walkWood([](flecs::iter&, const Count*, const Position*) {});
+
+        const QueryStats& after = statsFor(m);
+        QueryStats&       total = totals[static_cast<size_t>(m)];
+        total.built += after.built - before.built;
+        total.tables += after.tables - before.tables;
+        total.buildMs += after.buildMs - before.buildMs;
+        total.walkMs += after.walkMs - before.walkMs;
+    }
+    queries.mode = mode;
+}
+
+int main(int argc, char** argv) {
+    HeadlessOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        fmt::println(
+            "usage: {} [--size N] [--workers N] [--trees N] [--seed N] "
+            "[--ticks N] [--threads N] [--record FILE | --replay FILE] "
+            "[--trace FILE] [--rest 1] [--queries 1] [--edits N]",
+            argv[0]
+        );
+        return 1;
+    }
+
+    std::optional<ReplayLog> replay;
+    if (!options.replay.empty()) {
+        replay = loadReplay(options.replay);
+        if (!replay || !applyInputs(*replay, options)) {
+            return 1;
+        }
+    }
+    ReplayLog record{.inputs = recordInputs(options)};
+    const bool lockstep = replay || !options.record.empty();
+
+    const Clock::time_point setupStart = Clock::now();
+    Simulation              sim(
+        headlessTilemap({options.size, options.size}, options.seed),
+        {.workers     = options.workers,
+         .trees       = options.trees,
+         .threads     = options.threads,
+         .tickSeconds = 1.f,
+         .seed        = options.seed,
+         .lockstep    = lockstep,
+         .metrics     = options.rest}
+    );
+    if (options.rest) {
+        sim.ecs.set<flecs::Rest>({});
+    }
+    PhaseTimes times;
+    timePhases(sim.ecs, times);
+    const double setupMs =
+        std::chrono::duration<double, std::milli>(Clock::now() - setupStart)
+            .count();
+
+    // Each progress() advances the tick timer by exactly one interval
+    const Clock::time_point   start           = Clock::now();
+    bool                      diverged        = false;
+    std::array<QueryStats, 2> walks           = {};
+    uint64_t                  warmAllocations = 0;
+    int                       flipped         = 0;
+    for (int i = 0; i < options.ticks && !diverged; ++i) {
+        flipped += editTiles(sim, options.edits);
+        times.mark = Clock::now();
+        sim.ecs.progress(1.f);
+        if (i == 0) {
+            warmAllocations = pathStats.allocations;
+        }
+        if (options.queries) {
+            walkQueries(sim.queries, walks);
+        }
+
+        if (!lockstep) {
+            continue;
+        }
+        const uint64_t hash = worldHash(sim.ecs, sim.queries);
+        record.hashes.push_back(hash);
+        if (replay && replay->hashes[i] != hash) {
+            logger.flush();
+            fmt::println(
+                "[replay] Diverged at tick {}: expected {:016x}, got {:016x}",
+                i + 1, replay->hashes[i], hash
+            );
+            diverged = true;
+        }
+    }
+    const double seconds =
+        std::chrono::duration<double>(Clock::now() - start).count();
+    const int ticks = sim.ecs.get<Tick>()->v;
+    // The report goes after whatever the simulation logged
+    logger.flush();
+
+    fmt::println(
+        "# {}x{} map, {} workers, {} trees, seed {}, {} threads, setup {:.1f} "
+        "ms",
+        options.size, options.size, options.workers, options.trees,
+        options.seed, options.threads, setupMs
+    );
+    fmt::println(
+        "ticks {} in {:.3f} s: {:.1f} ticks/s", ticks, seconds,
+        seconds > 0 ? ticks / seconds : 0
+    );
+    // Searches and result buffers should stop growing after the first ticks
+    fmt::println(
+        "path allocations: {} in the first tick, {} after",
+        warmAllocations, pathStats.allocations - warmAllocations
+    );
+    if (options.edits > 0) {
+        fmt::println(
+            "map edits: {} tiles flipped, {} paths being repaired at the end",
+            flipped, sim.pathfinder.replanners.size()
+        );
+    }
+    for (size_t i = 0; i < PHASES.size(); ++i) {
+        fmt::println(
+            "{:<10} {:>10.3f} ms/tick", PHASES[i].name,
+            ticks ? times.ms[i] / ticks : 0
+        );
+    }
+    if (options.queries && ticks > 0) {
+        fmt::println(
+            "{:<10} {:>10} {:>11} {:>13} {:>12}", "queries", "built/tick",
+            "tables/tick", "build us/tick", "walk us/tick"
+        );
+        for (QueryMode m : QUERY_MODES) {
+            const QueryStats& w = walks[static_cast<size_t>(m)];
+            fmt::println(
+                "{:<10} {:>10.1f} {:>11.1f} {:>13.2f} {:>12.2f}",
+                m == QueryMode::Cached ? "cached" : "ad-hoc",
+                double(w.built) / ticks, double(w.tables) / ticks,
+                w.buildMs * 1000 / ticks, w.walkMs * 1000 / ticks
+            );
+        }
+    }
+
+#ifdef PROFILER
+    profiler.report();
+    if (!options.trace.empty() && !profiler.writeTrace(options.trace)) {
+        return 1;
+    }
+#else
+    if (!options.trace.empty()) {
+        fmt::println("--trace needs a build with PROFILER defined");
+    }
+#endif
+    if (!options.record.empty() && !saveReplay(options.record, record)) {
+        return 1;
+    }
+    if (replay && !diverged) {
+        fmt::println("[replay] All {} ticks match", ticks);
+    }
+    return diverged ? 1 : 0;
+}
@@ -5,7 +5,10 @@
 #include <functional>
 #include <unordered_map>
 
+#include "../utils/log.h"
+#include "../utils/profiler.h"
 #include "../utils/util.h"
+#include "planner_stats.h"
 
 /**** Sanity Aliases ****/
 
@@ -101,6 +104,9 @@ struct HTN {
     Map<std::string, Vec<Method>> methods;
 
     Option<Vec<Task>> hop(State state, Vec<Task> tasks) {
+        PROFILE_SCOPE("HTN::hop");
+        plannerStats.calls += 1;
+        plannerStats.depth = 0;
         return seek_plan(state, tasks, {}, 0);
     }
 
@@ -110,10 +116,14 @@ struct HTN {
         // value here. This is because we want to be able to backtrack and try
         // different plans without affecting the original state or plan.
 
+        if (depth > plannerStats.depth) {
+            plannerStats.depth = depth;
+        }
+
         std::string spaces(depth * 2, ' ');
-        fmt::println("{}{} Tasks: {}", depth, spaces, tasks);
+        LOG(Trace, Htn, "{}{} Tasks: {}", depth, spaces, tasks);
         if (tasks.empty()) {
-            fmt::println("{}{} Plan: {}", depth, spaces, plan);
+            LOG(Trace, Htn, "{}{} Plan: {}", depth, spaces, plan);
             return plan;
         }
 
@@ -122,11 +132,17 @@ struct HTN {
         if (operators.contains(task.name)) {
             auto        op = operators[task.name];
             std::string spaces(depth * 2, ' ');
-            fmt::println("{}{:s} Operator: {}", depth, spaces, task);
+            LOG(
+                Trace, Htn, "{}{:s} Operator: Task: {}", depth, spaces,
+                task.name
+            );
 
             auto newState = op(state, task.attrs);
             if (!newState) {
-                fmt::println("{}{} Operator failed: {}", depth, spaces, task);
+                LOG(
+                    Trace, Htn, "{}{} Operator failed: Task: {}", depth, spaces,
+                    task.name
+                );
                 return std::nullopt;
             }
 
@@ -134,17 +150,20 @@ struct HTN {
             plan.push_back(task);
             return seek_plan(*newState, rest, plan, depth + 1);
         } else if (methods.contains(task.name)) {
-            fmt::println("{}{} Composite Task: {}", depth, spaces, task);
+            LOG(
+                Trace, Htn, "{}{} Composite Task: Task: {}", depth, spaces,
+                task.name
+            );
             auto relevant = methods[task.name];
             int  i        = 0;
             for (const Method& method : relevant) {
                 i++;
                 auto subtasks = method(state, task.attrs);
-                fmt::println("{}{} i-th Method {}", depth, spaces, i);
+                LOG(Trace, Htn, "{}{} i-th Method {}", depth, spaces, i);
                 if (!subtasks) {
                     continue;
                 }
-                fmt::println("{}{} New Tasks: {}", depth, spaces, *subtasks);
+                LOG(Trace, Htn, "{}{} New Tasks: {}", depth, spaces, *subtasks);
                 subtasks->insert(
                     subtasks->end(), tasks.begin() + 1, tasks.end()
                 );
@@ -156,7 +175,8 @@ struct HTN {
             }
             return std::nullopt;
         }
-        fmt::println(
+        LOG(
+            Error, Htn,
             "[Error] Task is not an operator or componsite task: {}", task.name
         );
         return std::nullopt;
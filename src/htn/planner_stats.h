@@ -0,0 +1,12 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Planner counters, published as metrics (see metrics.h)
+struct PlannerStats {
+    std::atomic<uint64_t> calls = 0;  // plans asked for
+    std::atomic<int>      depth = 0;  // deepest recursion of the last plan
+};
+
+PlannerStats plannerStats;
@@ -2,6 +2,7 @@
 
 #include <flecs.h>
 
+#include <cassert>
 #include <iostream>
 
 // This example shows one possible way to implement an inventory system using
@@ -98,13 +99,35 @@ flecs::entity get_container(flecs::entity container) {
     return container.target<Inventory>();
 }
 
+// Queries the inventory functions reuse instead of building one per call.
+// Stored as a world singleton by register_inventory_queries.
+struct InventoryQueries {
+    flecs::rule<> items;          // (ContainedBy, $container)
+    int32_t       container_var;  // index of $container in `items`
+};
+
+void register_inventory_queries(flecs::world &ecs) {
+    if (ecs.has<InventoryQueries>()) {
+        return;
+    }
+    // Rules aren't freed with the world's components, so release them when
+    // the singleton goes, at the latest when the world is destroyed
+    ecs.component<InventoryQueries>().on_remove([](InventoryQueries &queries) {
+        queries.items.destruct();
+    });
+    flecs::rule<> items =
+        ecs.rule_builder().with<ContainedBy>("$container").build();
+    ecs.set<InventoryQueries>({items, items.find_var("container")});
+}
+
 // Iterate all items in an inventory
 template <typename Func>
 void for_each_item(flecs::entity container, const Func &func) {
-    container.world()
-        .filter_builder()
-        .with<ContainedBy>(container)
-        .build()
+    const InventoryQueries *queries =
+        container.world().get<InventoryQueries>();
+    assert(queries && "call register_inventory_queries first");
+    queries->items.iter()
+        .set_var(queries->container_var, container)
         .each(func);
 }
 
@@ -284,6 +307,7 @@ int foo(int, char *[]) {
     // Register ContainedBy relationship
     ecs.component<ContainedBy>().add(flecs::Exclusive
     );  // Item can only be contained by one container
+    register_inventory_queries(ecs);
 
     // Register item kinds
     ecs.component<Sword>().is_a<Item>();
@@ -6,15 +6,12 @@
 #include <iostream>
 #include <random>
 
-#include "components.h"
-#include "gather_wood_behavior.h"
 // #include "htn/htn.h"
 #include "htn/htn2.h"
-#include "pathfinder.h"
+#include "simulation.h"
 #include "tilemap.h"
-#include "trees.h"
+#include "utils/profiler.h"
 #include "utils/util.h"
-#include "workers.h"
 
 Tilemap makeTilemap() {
     using Tilemap::Grass;
@@ -40,22 +37,7 @@ Tilemap makeTilemap() {
     };
 }
 
-sf::View   initWindow(sf::RenderWindow& window);
-Pathfinder pathfinderFromTilemap(const Tilemap& map);
-
-void simulationUpdate(
-    flecs::world& ecs, const Tilemap& map, Pathfinder& pathfinder
-) {
-    Tick* tick = ecs.get_mut<Tick>();
-    tick->v += 1;
-    fmt::println("\n[simulationUpdate] tick: {}", tick->v);
-
-    gatherWoodBehaviorNaive(ecs, map, pathfinder);
-
-    ecs.each([](const Count& count, const Position& pos) {
-        fmt::println("Wood at {}, count: {}", pos.v, count.v);
-    });
-}
+sf::View initWindow(sf::RenderWindow& window);
 
 int main() {
     htn_main2();
@@ -64,18 +46,20 @@ int main() {
     auto      window = sf::RenderWindow{{1920u, 1080u}, "Watchem Gatherum"};
     sf::View  view   = initWindow(window);
     sf::Clock frameClock;
-    sf::Clock simulationClock;
     const int SIM_TICK_MS = 200;
 
-    flecs::world ecs;
-    Tilemap      map        = makeTilemap();
-    Pathfinder   pathfinder = pathfinderFromTilemap(map);
-
-    ecs.set<flecs::Rest>({});
-
-    registerComponents(ecs);
-    spawnWorkers(ecs, 3, map);
-    spawnTrees(ecs, 10, map);
+    // A fresh world each run; the seed is logged so a run can be repeated
+    const uint64_t seed = std::random_device{}();
+    fmt::println("[main] seed: {}", seed);
+    Simulation sim(
+        makeTilemap(),
+        {.workers     = 3,
+         .trees       = 10,
+         .tickSeconds = SIM_TICK_MS / 1000.f,
+         .seed        = seed,
+         .metrics     = true}
+    );
+    sim.ecs.set<flecs::Rest>({});
 
     for (int frame = 0; window.isOpen(); ++frame) {
         sf::Time deltaTime = frameClock.restart();
@@ -97,53 +81,29 @@ int main() {
                     if (event.key.code == sf::Keyboard::Escape) {
                         window.close();
                     }
+#ifdef PROFILER
+                    // Dump what the profiler has seen so far
+                    if (event.key.code == sf::Keyboard::P) {
+                        profiler.report();
+                        profiler.writeTrace("trace.json");
+                    }
+#endif
                     break;
                 default:
                     break;
             }
         }
 
-        if (simulationClock.getElapsedTime().asMilliseconds() > SIM_TICK_MS) {
-            // Only clear the debug drawer every simulation tick since
-            // it will only be written to during the simulation update
-            // and otherwise it will be cleared every frame
-            debugDrawer.clear(SIM_DEBUG_LAYER);
+        sim.map.render(window);
 
-            simulationUpdate(ecs, map, pathfinder);
-            simulationClock.restart();
-        };
+        renderWorkers(sim.queries, sim.map);
+        renderTrees(sim.queries, sim.map);
+        renderWood(sim.woodPiles, sim.map);
 
-        map.render(window);
-
-        renderWorkers(ecs, map);
-        renderTrees(ecs, map);
-        renderWood(ecs, map);
-
-        ecs.progress(deltaTime.asSeconds());
+        sim.ecs.progress(deltaTime.asSeconds());
 
         textDrawer.display(window);
         debugDrawer.display(window);
         window.display();
     }
 }
-
-Pathfinder pathfinderFromTilemap(const Tilemap& map) {
-    std::vector<unsigned char> pathmap(map.tiles.size());
-    std::transform(
-        map.tiles.begin(), map.tiles.end(), pathmap.begin(),
-        [](Tilemap::TileType t) { return t == Tilemap::Grass ? 1 : 0; }
-    );
-    return Pathfinder{.map = pathmap, .mapDim = map.dim};
-}
-
-sf::View initWindow(sf::RenderWindow& window) {
-    window.setFramerateLimit(144);
-    sf::Vector2u windowSize = window.getSize();
-    sf::View     view;
-    // view.setCenter(0, 0);
-    view.setSize(
-        static_cast<float>(windowSize.x), static_cast<float>(windowSize.y)
-    );
-    window.setView(view);
-    return view;
-}
\ No newline at end of file
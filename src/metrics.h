@@ -0,0 +1,111 @@
+#pragma once
+
+#include <flecs.h>
+#include <fmt/core.h>
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+#include "components.h"
+#include "htn/planner_stats.h"
+#include "pathing/search_workspace.h"
+#include "trees.h"
+
+// Simulation counters as flecs metrics. Each field of the SimMetrics
+// singleton becomes a metric entity under `metrics::`, which the explorer
+// lists and charts over the REST endpoint, with history kept by the monitor
+// module. Per-tick fields are gauges; running totals are counters, which
+// the explorer shows as a rate.
+
+struct SimMetrics {
+    double pathsPerTick  = 0;
+    double nodesExpanded = 0;  // by path searches, per tick
+    // Workers by state
+    double idle     = 0;
+    double moving   = 0;
+    double chopping = 0;
+    double waiting  = 0;  // on a path query
+    double carrying = 0;
+    double woodDeposited = 0;  // per tick
+    double plannerCalls  = 0;  // total
+    double plannerDepth  = 0;  // of the last plan
+    double allocations   = 0;  // search buffer growths, total
+};
+
+struct MetricField {
+    const char*         name;
+    double SimMetrics::*field;
+    bool                counter;
+    const char*         brief;
+};
+
+const std::array<MetricField, 11> METRIC_FIELDS = {{
+    {"pathsPerTick", &SimMetrics::pathsPerTick, false, "Path searches"},
+    {"nodesExpanded", &SimMetrics::nodesExpanded, false, "Search nodes"},
+    {"idle", &SimMetrics::idle, false, "Idle workers"},
+    {"moving", &SimMetrics::moving, false, "Moving workers"},
+    {"chopping", &SimMetrics::chopping, false, "Chopping workers"},
+    {"waiting", &SimMetrics::waiting, false, "Workers waiting on a path"},
+    {"carrying", &SimMetrics::carrying, false, "Workers carrying wood"},
+    {"woodDeposited", &SimMetrics::woodDeposited, false, "Wood dropped off"},
+    {"plannerCalls", &SimMetrics::plannerCalls, true, "HTN plans"},
+    {"plannerDepth", &SimMetrics::plannerDepth, false, "HTN plan depth"},
+    {"allocations", &SimMetrics::allocations, true, "Search allocations"},
+}};
+
+// Adds the metrics and a system that refreshes them at the end of each tick.
+// Register after the simulation's own systems.
+void registerMetrics(
+    flecs::world& ecs, flecs::entity tick, const WoodPiles& piles
+) {
+    ecs.import<flecs::metrics>();
+    ecs.import<flecs::monitor>();
+
+    auto component = ecs.component<SimMetrics>();
+    for (const MetricField& metric : METRIC_FIELDS) {
+        component.member(metric.name, metric.field);
+    }
+    ecs.set<SimMetrics>({});
+
+    for (const MetricField& metric : METRIC_FIELDS) {
+        const std::string path = fmt::format("metrics::{}", metric.name);
+        auto              builder = ecs.metric(path.c_str());
+        builder.member<SimMetrics>(metric.name).brief(metric.brief);
+        if (metric.counter) {
+            builder.kind<flecs::metrics::Counter>();
+        } else {
+            builder.kind<flecs::metrics::Gauge>();
+        }
+    }
+
+    ecs.system("PublishMetrics")
+        .kind(flecs::PostUpdate)
+        .tick_source(tick)
+        .iter([&ecs, &piles](flecs::iter& it) {
+            // Totals at the end of the last tick
+            static uint64_t queries   = 0;
+            static uint64_t nodes     = 0;
+            static uint64_t deposited = 0;
+
+            const uint64_t q      = pathStats.queries;
+            const uint64_t n      = pathStats.nodesExpanded;
+            SimMetrics     values = {
+                .pathsPerTick  = double(q - queries),
+                .nodesExpanded = double(n - nodes),
+                .idle          = double(ecs.count<Idle>()),
+                .moving        = double(ecs.count<MoveTo>()),
+                .chopping      = double(ecs.count<ChopingTree>()),
+                .waiting       = double(ecs.count<PathPending>()),
+                .carrying      = double(ecs.count<CarryingWood>()),
+                .woodDeposited = double(piles.deposited - deposited),
+                .plannerCalls  = double(plannerStats.calls),
+                .plannerDepth  = double(plannerStats.depth),
+                .allocations   = double(pathStats.allocations),
+            };
+            queries   = q;
+            nodes     = n;
+            deposited = piles.deposited;
+            it.world().set<SimMetrics>(values);
+        });
+}
@@ -0,0 +1,266 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "pathfinder.h"
+#include "utils/profiler.h"
+
+// Asynchronous path queries. The simulation submits requests during a tick,
+// a pool of threads solves them against a read-only copy of the Pathfinder,
+// and the results are collected at the start of the next tick.
+
+struct PathRequest {
+    uint64_t ticket;
+    uint64_t owner;
+    Position start;
+    Position target;
+    // If set, search for the nearest of these tiles instead of `target`
+    std::shared_ptr<const BitGrid>        goals;
+    std::chrono::steady_clock::time_point submitted;
+};
+
+struct PathResult {
+    uint64_t         ticket;
+    uint64_t         owner;
+    bool             found;
+    Position         goal;
+    bool             nearest;   // `goal` was picked from the request's goals
+    std::vector<int> path;      // tile indices, see Pathfinder::positions
+    uint32_t         revision;  // of the snapshot the path was found on
+    double           latencyMs;
+};
+
+struct PathServiceStats {
+    size_t   queueDepth;
+    uint64_t submitted;
+    uint64_t completed;
+    // Over the results handed out by the last drain
+    size_t drained;
+    double meanLatencyMs;
+    double maxLatencyMs;
+};
+
+class PathService {
+   public:
+    // Requests a thread takes off the queue per lock
+    static constexpr size_t BATCH_SIZE = 32;
+
+    explicit PathService(int threads) {
+        for (int i = 0; i < std::max(threads, 1); ++i) {
+            workers.emplace_back([this] { run(); });
+        }
+    }
+
+    ~PathService() {
+        {
+            std::lock_guard lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& t : workers) {
+            t.join();
+        }
+    }
+
+    // Take a fresh copy of the walkability data. Requests already picked up
+    // finish against the copy they started with.
+    void setSnapshot(const Pathfinder& pathfinder) {
+        auto copy = std::make_shared<Pathfinder>(pathfinder.snapshot());
+        std::lock_guard lock(mutex);
+        snapshot = std::move(copy);
+    }
+
+    uint32_t snapshotRevision() const {
+        std::lock_guard lock(mutex);
+        return snapshot ? snapshot->revision : UINT32_MAX;
+    }
+
+    uint64_t submit(uint64_t owner, Position start, Position target) {
+        return enqueue({.owner = owner, .start = start, .target = target});
+    }
+
+    // Tiles that nearest-goal requests submitted from now on search for.
+    // Each request keeps the set that was current when it was submitted.
+    void setGoals(const BitGrid& tiles) {
+        std::lock_guard lock(mutex);
+        // Overwrite the last set in place once no request holds it
+        if (goals && goals.use_count() == 1) {
+            *goals = tiles;
+        } else {
+            goals = std::make_shared<BitGrid>(tiles);
+        }
+    }
+
+    // Path to whichever tile of the current goal set is nearest to `start`
+    // by walking distance
+    uint64_t submitNearest(uint64_t owner, Position start) {
+        std::shared_ptr<const BitGrid> tiles;
+        {
+            std::lock_guard lock(mutex);
+            tiles = goals;
+        }
+        return enqueue({.owner = owner, .start = start, .goals = tiles});
+    }
+
+    // Block until every request submitted so far has a result. Draining after
+    // this hands out the same results whatever the threads' timing was.
+    void settle() {
+        std::unique_lock lock(mutex);
+        settled.wait(lock, [this] { return queue.empty() && solving == 0; });
+    }
+
+    // Sync point: move every finished result into `out`. Hand them back with
+    // recycle once read, so their path buffers are reused.
+    void drain(std::vector<PathResult>& out) {
+        out.clear();
+        std::lock_guard lock(mutex);
+        std::swap(out, done);
+
+        double total = 0;
+        double worst = 0;
+        for (const PathResult& r : out) {
+            total += r.latencyMs;
+            worst = std::max(worst, r.latencyMs);
+        }
+        stats_.completed += out.size();
+        stats_.drained       = out.size();
+        stats_.meanLatencyMs = out.empty() ? 0 : total / out.size();
+        stats_.maxLatencyMs  = worst;
+    }
+
+    void recycle(std::vector<PathResult>& results) {
+        std::lock_guard lock(mutex);
+        for (PathResult& result : results) {
+            if (result.path.capacity() > 0) {
+                result.path.clear();
+                sparePaths.push_back(std::move(result.path));
+            }
+        }
+        results.clear();
+    }
+
+    PathServiceStats stats() const {
+        std::lock_guard  lock(mutex);
+        PathServiceStats s = stats_;
+        s.queueDepth       = queue.size();
+        return s;
+    }
+
+   private:
+    std::vector<std::thread>          workers;
+    mutable std::mutex                mutex;
+    std::condition_variable           wake;
+    std::condition_variable           settled;
+    std::deque<PathRequest>           queue;
+    std::vector<PathResult>           done;
+    std::vector<std::vector<int>>     sparePaths;
+    std::shared_ptr<const Pathfinder> snapshot;
+    std::shared_ptr<BitGrid>          goals;
+    uint64_t                          nextTicket = 1;
+    size_t                            solving    = 0;  // taken, not done
+    bool                              stopping   = false;
+    PathServiceStats                  stats_     = {};
+
+    uint64_t enqueue(PathRequest request) {
+        request.submitted = std::chrono::steady_clock::now();
+        uint64_t ticket;
+        {
+            std::lock_guard lock(mutex);
+            ticket = request.ticket = nextTicket++;
+            queue.push_back(std::move(request));
+            stats_.submitted += 1;
+        }
+        wake.notify_one();
+        return ticket;
+    }
+
+    void run() {
+        std::vector<PathRequest> batch;
+        std::vector<PathResult>  results;
+        while (true) {
+            std::shared_ptr<const Pathfinder> pathfinder;
+            {
+                std::unique_lock lock(mutex);
+                wake.wait(lock, [this] {
+                    return stopping || (!queue.empty() && snapshot);
+                });
+                if (stopping) {
+                    return;
+                }
+                const size_t n = std::min(queue.size(), BATCH_SIZE);
+                batch.assign(
+                    std::make_move_iterator(queue.begin()),
+                    std::make_move_iterator(queue.begin() + n)
+                );
+                queue.erase(queue.begin(), queue.begin() + n);
+                solving += n;
+                pathfinder = snapshot;
+
+                results.resize(n);
+                for (PathResult& result : results) {
+                    if (!sparePaths.empty()) {
+                        result.path = std::move(sparePaths.back());
+                        sparePaths.pop_back();
+                    }
+                }
+            }
+
+            for (size_t i = 0; i < batch.size(); ++i) {
+                solve(*pathfinder, batch[i], results[i]);
+            }
+
+            {
+                std::lock_guard lock(mutex);
+                std::move(
+                    results.begin(), results.end(), std::back_inserter(done)
+                );
+                results.clear();
+                // Let go of the goal sets so setGoals can reuse them
+                for (PathRequest& request : batch) {
+                    request.goals.reset();
+                }
+                solving -= batch.size();
+            }
+            settled.notify_all();
+        }
+    }
+
+    // Fill `result`, writing the path into the buffer it already holds
+    static void solve(
+        const Pathfinder& pf, const PathRequest& request, PathResult& result
+    ) {
+        PROFILE_SCOPE("PathService::solve");
+        result.ticket   = request.ticket;
+        result.owner    = request.owner;
+        result.found    = false;
+        result.goal     = request.target;
+        result.nearest  = request.goals != nullptr;
+        result.revision = pf.revision;
+
+        if (!request.goals) {
+            result.found = pf.find(request.start, request.target, result.path);
+        } else {
+            const BitGrid& goals   = *request.goals;
+            auto           nearest = pf.findNearest(
+                request.start, [&](Position p) { return goals.get(p.v); },
+                result.path
+            );
+            result.found = nearest.has_value();
+            result.goal  = nearest.value_or(request.target);
+        }
+
+        const auto elapsed =
+            std::chrono::steady_clock::now() - request.submitted;
+        result.latencyMs =
+            std::chrono::duration<double, std::milli>(elapsed).count();
+    }
+};
@@ -1,34 +1,311 @@
-
 #pragma once
 
-#include <deque>
 #include <optional>
+#include <ranges>
+#include <unordered_map>
+#include <vector>
 
-#include "pathfinding/astar.h"
+#include "components.h"
+#include "pathing/astar.h"
+#include "pathing/dijkstra.h"
+#include "pathing/dstar_lite.h"
+#include "pathing/flow_field.h"
+#include "pathing/hpa.h"
+#include "pathing/jps.h"
+#include "pathing/regions.h"
+#include "utils/profiler.h"
 #include "utils/util.h"
 
+// Maps with at least this many tiles get an HPA* hierarchy
+const int HPA_MIN_TILES    = 256 * 256;
+const int HPA_CLUSTER_SIZE = 16;
+// Cluster hops refined per hierarchical query. Workers ask for the rest of
+// the route when they reach the end of what was refined.
+const int HPA_REFINE_SEGMENTS = 4;
+
+// Search used for flat (non-hierarchical) queries. JPS assumes uniform
+// costs, so maps with a terrain layer always use A*.
+enum class PathBackend {
+    AStar,
+    Jps,
+};
+
 struct Pathfinder {
-    std::vector<unsigned char> map;
-    Vec2I                      mapDim;
+    BitGrid                 map;  // walkable tiles
+    PathBackend             backend = PathBackend::AStar;
+    std::optional<HpaGraph> hierarchy;
+    RegionLabels            regions;
+    FlowFieldCache          flowFields;
+    uint32_t                revision = 0;
+    // Per-tile weights (see TERRAIN_UNIT); empty while every tile is plain
+    std::vector<uint8_t> terrain;
+    int                  minTerrain = TERRAIN_UNIT;
+
+    // Repair agents' paths with D* Lite when tiles change instead of
+    // searching again from scratch
+    bool                                    incremental = false;
+    std::unordered_map<uint64_t, DStarLite> replanners;
 
     // Call operator that forwards to find method
-    std::optional<std::deque<Position>>
-    operator()(Position start, Position target) {
-        return find(start, target);
+    bool operator()(Position start, Position target, std::vector<int>& path)
+        const {
+        return find(start, target, path);
+    }
+
+    // Searches run in the calling thread's workspace and the tiles after
+    // `start` are written into the caller's `path`, so once both have grown
+    // to fit, a query allocates nothing. Long queries on a hierarchical map
+    // may return only the first stretch of the route.
+    bool find(Position start, Position target, std::vector<int>& path) const {
+        PROFILE_SCOPE("Pathfinder::find");
+        path.clear();
+        if (!reachable(start, target)) {
+            return false;
+        }
+
+        const std::vector<int>* tiles = nullptr;
+        if (hierarchy && octile(start.v, target.v) >
+                             2 * HPA_CLUSTER_SIZE * STRAIGHT_COST) {
+            static thread_local std::vector<int> refined;
+            if (!hierarchy->find(
+                    grid(), index(start), index(target), HPA_REFINE_SEGMENTS,
+                    refined
+                )) {
+                return false;
+            }
+            tiles = &refined;
+        } else {
+            SearchWorkspace& ws = searchWorkspace;
+            if (!searchFlat(index(start), index(target), ws)) {
+                return false;
+            }
+            tiles = &ws.path;
+        }
+        SearchWorkspace::copy(*tiles, path);
+        return true;
     }
 
-    std::optional<std::deque<Position>> find(Position start, Position target) {
-        std::vector<int> path(map.size());
-        if (!AStarFindPath(
-                toPair(start.v), toPair(target.v), map, toPair(mapDim), path
-            )) {
+    // O(1) check against the connected-component labels. Searches between
+    // separate islands are rejected before doing any work.
+    bool reachable(Position a, Position b) const {
+        return regions.label.empty() ||
+               regions.reachable(index(a), index(b));
+    }
+
+    // Closest tile by walking distance for which `isGoal(Position)` holds,
+    // found in a single search however many candidates there are. The path
+    // to it goes into `path` as with find.
+    template <typename Pred>
+    std::optional<Position> findNearest(
+        Position start, Pred&& isGoal, std::vector<int>& path
+    ) const {
+        PROFILE_SCOPE("Pathfinder::findNearest");
+        path.clear();
+        SearchWorkspace& ws   = searchWorkspace;
+        const GridView   g    = grid();
+        const int        goal = dijkstraNearest(
+            g, index(start),
+            [&](int node) { return isGoal(Position(g.pos(node))); }, ws
+        );
+        if (goal == -1) {
             return std::nullopt;
         }
+        SearchWorkspace::copy(ws.path, path);
+        return Position(g.pos(goal));
+    }
+
+    // Tile indices from find, findNearest or replan as Positions, e.g. to
+    // build a CompactPath without copying them first
+    auto positions(const std::vector<int>& tiles) const {
+        return tiles | std::views::transform([width = map.dim.x](int i) {
+                   return Position(Vec2I(i % width, i / width));
+               });
+    }
+
+    bool searchFlat(int start, int goal, SearchWorkspace& ws) const {
+        switch (terrain.empty() ? backend : PathBackend::AStar) {
+            case PathBackend::Jps:
+                return jpsSearch(grid(), start, goal, ws);
+            case PathBackend::AStar:
+            default:
+                return astarSearch(grid(), start, goal, ws);
+        }
+    }
 
-        std::deque<Position> result;
-        for (int pos : path) {
-            result.push_back(Position(Vec2I{pos % mapDim.x, pos / mapDim.x}));
+    void buildRegions() {
+        regions.build(grid());
+    }
+
+    void buildHierarchy(int clusterSize) {
+        hierarchy = HpaGraph::build(grid(), clusterSize);
+    }
+
+    // Shared distance map toward `goals`, built once and reused until the
+    // walkability map changes
+    const FlowField& flowField(const std::vector<Position>& goals) {
+        PROFILE_SCOPE("Pathfinder::flowField");
+        static thread_local std::vector<int> key;
+        key.clear();
+        for (const Position& goal : goals) {
+            key.push_back(index(goal));
+        }
+        return flowFields.get(grid(), key, revision);
+    }
+
+    // O(1) next step toward `target` if a flow field leads there. A field
+    // left stale by map edits is rebuilt once here, so its walkers keep
+    // following it instead of each falling back to a path query.
+    std::optional<Position> stepToward(Position pos, Position target) {
+        const FlowField* field =
+            flowFields.find(grid(), index(target), revision);
+        if (!field || !field->reachable(pos.v) ||
+            field->goalFor(pos.v) != target.v) {
+            return std::nullopt;
+        }
+        auto next = field->next(pos.v);
+        if (!next) {
+            return std::nullopt;
+        }
+        return Position(*next);
+    }
+
+    // Path from `start` to `target` for `agent`, reusing the agent's search
+    // from its last call if the target is the same. Only the part of that
+    // search touched by tiles changed since then is redone.
+    bool replan(
+        uint64_t agent, Position start, Position target, std::vector<int>& path
+    ) {
+        PROFILE_SCOPE("Pathfinder::replan");
+        if (!reachable(start, target)) {
+            forget(agent);
+            path.clear();
+            return false;
+        }
+
+        DStarLite& planner = replanners[agent];
+        if (planner.goal != index(target)) {
+            planner.init(grid(), index(start), index(target));
+        } else {
+            planner.moveStart(grid(), index(start));
+        }
+
+        const uint64_t before = planner.expanded;
+        const bool     found  = planner.plan(grid(), path);
+        pathStats.queries += 1;
+        pathStats.nodesExpanded += planner.expanded - before;
+        return found;
+    }
+
+    // Copy of what find and findNearest read, leaving out the flow field
+    // and replanner caches, which a read-only copy never uses
+    Pathfinder snapshot() const {
+        Pathfinder copy;
+        copy.map        = map;
+        copy.backend    = backend;
+        copy.hierarchy  = hierarchy;
+        copy.regions    = regions;
+        copy.revision   = revision;
+        copy.terrain    = terrain;
+        copy.minTerrain = minTerrain;
+        return copy;
+    }
+
+    // Drop an agent's incremental search state once it stops moving
+    void forget(uint64_t agent) {
+        replanners.erase(agent);
+    }
+
+    void setWalkable(Position pos, bool walkable) {
+        if (writeWalkable(pos, walkable)) {
+            tileChanged(pos);
+        }
+    }
+
+    // One map edit: `weight` 0 blocks the tile, anything else makes it
+    // walkable at that weight. Walkability, regions and terrain all change
+    // before the caches and replanners hear about it, once.
+    void setTile(Position pos, uint8_t weight) {
+        const bool walkable = writeWalkable(pos, weight != 0);
+        const bool weighted =
+            writeTerrain(pos, weight != 0 ? weight : TERRAIN_UNIT);
+        if (walkable || weighted) {
+            tileChanged(pos);
+        }
+    }
+
+    // Replace every tile's weight at once, e.g. when loading a map
+    void setTerrain(std::vector<uint8_t> weights) {
+        const bool plain = std::all_of(
+            weights.begin(), weights.end(),
+            [](uint8_t w) { return w == TERRAIN_UNIT; }
+        );
+        terrain    = plain ? std::vector<uint8_t>{} : std::move(weights);
+        minTerrain = TERRAIN_UNIT;
+        if (!terrain.empty()) {
+            minTerrain = *std::min_element(terrain.begin(), terrain.end());
+        }
+        revision += 1;
+        replanners.clear();
+        if (hierarchy) {
+            buildHierarchy(hierarchy->clusterSize);
+        }
+    }
+
+    void setTerrain(Position pos, uint8_t weight) {
+        if (writeTerrain(pos, weight)) {
+            tileChanged(pos);
+        }
+    }
+
+    GridView grid() const {
+        return GridView(
+            map, terrain.empty() ? nullptr : terrain.data(), minTerrain
+        );
+    }
+
+    int index(Position pos) const {
+        return pos.v.y * map.dim.x + pos.v.x;
+    }
+
+   private:
+    // The write* helpers update one layer and report whether it changed,
+    // leaving the invalidation to the caller
+    bool writeWalkable(Position pos, bool walkable) {
+        if (map.get(pos.v) == walkable) {
+            return false;
+        }
+        map.set(pos.v, walkable);
+        regions.update(grid(), index(pos), walkable);
+        return true;
+    }
+
+    bool writeTerrain(Position pos, uint8_t weight) {
+        if (terrain.empty()) {
+            if (weight == TERRAIN_UNIT) {
+                return false;
+            }
+            terrain.assign(map.dim.x * map.dim.y, TERRAIN_UNIT);
+        }
+        if (terrain[index(pos)] == weight) {
+            return false;
+        }
+        // Raising a weight can leave minTerrain low, which only makes the
+        // heuristic a little weaker
+        terrain[index(pos)] = weight;
+        minTerrain          = std::min<int>(minTerrain, weight);
+        return true;
+    }
+
+    // Invalidate everything derived from the tile costs around `pos`
+    void tileChanged(Position pos) {
+        revision += 1;
+        if (hierarchy) {
+            hierarchy->update(grid(), pos.v);
+        }
+        for (auto& [agent, planner] : replanners) {
+            if (planner.affectedBy(pos.v)) {
+                planner.tileChanged(grid(), index(pos));
+            }
         }
-        return result;
     }
-};
\ No newline at end of file
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <bit>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+// A* from `start` to `goal` over an 8-connected grid. On success the path,
+// excluding the start and including the goal, is left in `ws.path`.
+bool astarSearch(GridView grid, int start, int goal, SearchWorkspace& ws) {
+    ws.begin(grid.size());
+    if (!grid.walkable(grid.pos(goal))) {
+        ws.end();
+        return false;
+    }
+
+    const Vec2I goalPos = grid.pos(goal);
+    ws.reach(start, 0, -1);
+    ws.push({grid.heuristic(grid.pos(start), goalPos), 0, start});
+
+    while (!ws.open.empty()) {
+        auto [f, g, node] = ws.pop();
+        if (g > ws.gScore[node]) {
+            continue;  // stale entry, a cheaper route was queued later
+        }
+        if (node == goal) {
+            ws.trace(goal);
+            ws.end();
+            return true;
+        }
+        ws.expanded += 1;
+
+        const Vec2I p = grid.pos(node);
+        for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+            const Dir&  d      = DIRS[std::countr_zero(m)];
+            const Vec2I next   = {p.x + d.dx, p.y + d.dy};
+            const int   nextId = grid.index(next);
+            const int   nextG  = g + grid.stepCost(next, d.cost);
+            if (nextG >= ws.g(nextId)) {
+                continue;
+            }
+            ws.reach(nextId, nextG, node);
+            ws.push({nextG + grid.heuristic(next, goalPos), nextG, nextId});
+        }
+    }
+    ws.end();
+    return false;
+}
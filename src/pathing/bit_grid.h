@@ -0,0 +1,116 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <vector>
+
+#include "../utils/vectors.h"
+
+// One bit per tile, 64 tiles to a word. Every row is padded with a zero
+// column on both sides and the grid with a zero row above and below, so the
+// 3x3 window around any tile can be read without bounds checks.
+struct BitGrid {
+    Vec2I                 dim    = {0, 0};
+    int                   stride = 0;  // words per padded row
+    std::vector<uint64_t> words;
+
+    BitGrid() = default;
+
+    explicit BitGrid(Vec2I dim)
+        : dim(dim)
+        , stride((dim.x + 2 + 63) / 64)
+        , words(static_cast<size_t>(stride) * (dim.y + 2), 0) {}
+
+    bool get(int x, int y) const {
+        const size_t bit = this->bit(x, y);
+        return (words[bit / 64] >> (bit % 64)) & 1;
+    }
+
+    bool get(Vec2I p) const {
+        return get(p.x, p.y);
+    }
+
+    void set(Vec2I p, bool value) {
+        const size_t   bit  = this->bit(p.x, p.y);
+        const uint64_t mask = uint64_t(1) << (bit % 64);
+        if (value) {
+            words[bit / 64] |= mask;
+        } else {
+            words[bit / 64] &= ~mask;
+        }
+    }
+
+    // Every tile off, keeping the storage
+    void clear() {
+        std::fill(words.begin(), words.end(), 0);
+    }
+
+    // Tiles around `p` as 9 bits, row by row from the top left. Bit 4 is `p`.
+    uint16_t window(Vec2I p) const {
+        uint16_t result = 0;
+        for (int row = 0; row < 3; ++row) {
+            // Padding shifts columns by one, so column p.x - 1 is at bit p.x
+            const size_t first = static_cast<size_t>(p.y + row) * stride * 64 +
+                                 static_cast<size_t>(p.x);
+            const size_t w     = first / 64;
+            const int    shift = first % 64;
+            uint64_t     bits  = words[w] >> shift;
+            if (shift > 61) {
+                bits |= words[w + 1] << (64 - shift);
+            }
+            result |= static_cast<uint16_t>((bits & 0b111) << (3 * row));
+        }
+        return result;
+    }
+
+    int count() const {
+        int n = 0;
+        for (uint64_t word : words) {
+            n += std::popcount(word);
+        }
+        return n;
+    }
+
+    // The `k`th set tile in row-major order, counting from 0. Whole words
+    // are skipped by popcount, so this costs one pass over the words at
+    // most. `k` must be below count().
+    Vec2I nth(int k) const {
+        size_t w = 0;
+        for (int n = std::popcount(words[w]); n <= k;
+             n = std::popcount(words[++w])) {
+            k -= n;
+        }
+        uint64_t word = words[w];
+        for (; k > 0; --k) {
+            word &= word - 1;
+        }
+        return tile(w * 64 + std::countr_zero(word));
+    }
+
+    // Call `fn(Vec2I)` for every set tile in row-major order
+    template <typename Fn>
+    void forEach(Fn&& fn) const {
+        for (size_t w = 0; w < words.size(); ++w) {
+            for (uint64_t word = words[w]; word; word &= word - 1) {
+                fn(tile(w * 64 + std::countr_zero(word)));
+            }
+        }
+    }
+
+    size_t bytes() const {
+        return words.size() * sizeof(uint64_t);
+    }
+
+   private:
+    size_t bit(int x, int y) const {
+        return static_cast<size_t>(y + 1) * stride * 64 +
+               static_cast<size_t>(x + 1);
+    }
+
+    Vec2I tile(size_t bit) const {
+        const size_t row = bit / (static_cast<size_t>(stride) * 64);
+        const size_t col = bit % (static_cast<size_t>(stride) * 64);
+        return {static_cast<int>(col) - 1, static_cast<int>(row) - 1};
+    }
+};
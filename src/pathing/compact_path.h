@@ -0,0 +1,188 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+/**** Arena ****/
+
+// Shared storage for every compact path. Paths are stored as 3-bit direction
+// codes (indices into DIRS), 21 to a word, in power-of-two sized blocks that
+// are recycled through per-size free lists.
+struct PathArena {
+    static constexpr int      CODES_PER_WORD = 21;
+    static constexpr uint32_t NONE           = UINT32_MAX;
+
+    std::vector<uint64_t>                 words;
+    std::array<std::vector<uint32_t>, 32> freeBlocks;
+
+    static int sizeClassFor(int codes) {
+        const int needed = (codes + CODES_PER_WORD - 1) / CODES_PER_WORD;
+        int       c      = 0;
+        while ((1 << c) < needed) {
+            c += 1;
+        }
+        return c;
+    }
+
+    uint32_t allocate(int sizeClass) {
+        std::vector<uint32_t>& free = freeBlocks[sizeClass];
+        if (!free.empty()) {
+            const uint32_t block = free.back();
+            free.pop_back();
+            return block;
+        }
+        const uint32_t block = static_cast<uint32_t>(words.size());
+        if (words.size() + (1 << sizeClass) > words.capacity()) {
+            pathStats.allocations += 1;
+        }
+        words.resize(words.size() + (1 << sizeClass));
+        return block;
+    }
+
+    void release(uint32_t block, int sizeClass) {
+        SearchWorkspace::grow(freeBlocks[sizeClass]);
+        freeBlocks[sizeClass].push_back(block);
+    }
+
+    uint8_t get(uint32_t block, uint32_t i) const {
+        const uint64_t word = words[block + i / CODES_PER_WORD];
+        return (word >> (3 * (i % CODES_PER_WORD))) & 0b111;
+    }
+
+    void set(uint32_t block, uint32_t i, uint8_t code) {
+        uint64_t& word  = words[block + i / CODES_PER_WORD];
+        const int shift = 3 * (i % CODES_PER_WORD);
+        word = (word & ~(uint64_t(0b111) << shift)) | (uint64_t(code) << shift);
+    }
+};
+
+PathArena pathArena;
+
+/**** Path ****/
+
+// Remaining steps of a walk: the tile we're on plus one direction code per
+// step. Popping the front just advances a cursor. `P` is the tile type the
+// path hands out, which must wrap a Vec2I in `.v`.
+template <typename P>
+struct BasicCompactPath {
+    uint32_t block     = PathArena::NONE;
+    uint8_t  sizeClass = 0;
+    uint32_t head      = 0;
+    uint32_t length    = 0;
+    Vec2I    cursor;
+
+    struct Iterator {
+        using iterator_concept = std::forward_iterator_tag;
+        using value_type       = P;
+        using difference_type  = std::ptrdiff_t;
+
+        const BasicCompactPath* path = nullptr;
+        uint32_t                i    = 0;
+        Vec2I                   from;
+
+        P operator*() const {
+            const Dir& d = DIRS[pathArena.get(path->block, i)];
+            return P(Vec2I(from.x + d.dx, from.y + d.dy));
+        }
+        Iterator& operator++() {
+            from = (**this).v;
+            i += 1;
+            return *this;
+        }
+        Iterator operator++(int) {
+            Iterator old = *this;
+            ++*this;
+            return old;
+        }
+        bool operator==(const Iterator& other) const {
+            return i == other.i;
+        }
+    };
+
+    BasicCompactPath() = default;
+
+    // `tiles` must step at most one tile at a time, starting next to `start`
+    template <typename Tiles>
+    BasicCompactPath(P start, const Tiles& tiles)
+        : length(static_cast<uint32_t>(std::size(tiles))), cursor(start.v) {
+        if (length == 0) {
+            return;
+        }
+        sizeClass = PathArena::sizeClassFor(length);
+        block     = pathArena.allocate(sizeClass);
+
+        Vec2I    prev = start.v;
+        uint32_t i    = 0;
+        for (const P& tile : tiles) {
+            pathArena.set(block, i++, codeFor(tile.v - prev));
+            prev = tile.v;
+        }
+    }
+
+    BasicCompactPath(const BasicCompactPath& other)
+        : BasicCompactPath(P(other.cursor), other) {}
+
+    BasicCompactPath(BasicCompactPath&& other) noexcept {
+        swap(other);
+    }
+
+    BasicCompactPath& operator=(BasicCompactPath other) noexcept {
+        swap(other);
+        return *this;
+    }
+
+    ~BasicCompactPath() {
+        if (block != PathArena::NONE) {
+            pathArena.release(block, sizeClass);
+        }
+    }
+
+    void swap(BasicCompactPath& other) noexcept {
+        std::swap(block, other.block);
+        std::swap(sizeClass, other.sizeClass);
+        std::swap(head, other.head);
+        std::swap(length, other.length);
+        std::swap(cursor, other.cursor);
+    }
+
+    bool empty() const {
+        return length == 0;
+    }
+
+    size_t size() const {
+        return length;
+    }
+
+    P front() const {
+        return *begin();
+    }
+
+    void pop_front() {
+        cursor = front().v;
+        head += 1;
+        length -= 1;
+    }
+
+    Iterator begin() const {
+        return {this, head, cursor};
+    }
+
+    Iterator end() const {
+        return {this, head + length, cursor};
+    }
+
+    static uint8_t codeFor(Vec2I step) {
+        for (uint8_t k = 0; k < DIRS.size(); ++k) {
+            if (DIRS[k].dx == step.x && DIRS[k].dy == step.y) {
+                return k;
+            }
+        }
+        throw std::invalid_argument("path tiles are not adjacent");
+    }
+};
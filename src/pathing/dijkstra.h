@@ -0,0 +1,76 @@
+#pragma once
+
+#include <bit>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+// Uniform-cost flood from `start` over every tile reachable inside the view's
+// bounds. Afterwards `ws.g(node)` is the exact cost to each reached node.
+void dijkstraFlood(GridView grid, int start, SearchWorkspace& ws) {
+    ws.begin(grid.size());
+    ws.reach(start, 0, -1);
+    ws.push({0, 0, start});
+
+    while (!ws.open.empty()) {
+        auto [f, g, node] = ws.pop();
+        if (g > ws.gScore[node]) {
+            continue;
+        }
+        ws.expanded += 1;
+
+        const Vec2I p = grid.pos(node);
+        for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+            const Dir&  d      = DIRS[std::countr_zero(m)];
+            const Vec2I next   = {p.x + d.dx, p.y + d.dy};
+            const int   nextId = grid.index(next);
+            const int   nextG  = g + grid.stepCost(next, d.cost);
+            if (nextG >= ws.g(nextId)) {
+                continue;
+            }
+            ws.reach(nextId, nextG, node);
+            ws.push({nextG, nextG, nextId});
+        }
+    }
+    ws.end();
+}
+
+// Uniform-cost search from `start` that stops at the first node satisfying
+// `isGoal`, which is therefore the closest one by path cost. Returns that node
+// (with its path in `ws.path`) or -1 if no goal is reachable.
+template <typename Pred>
+int dijkstraNearest(
+    GridView grid, int start, Pred&& isGoal, SearchWorkspace& ws
+) {
+    ws.begin(grid.size());
+    ws.reach(start, 0, -1);
+    ws.push({0, 0, start});
+
+    while (!ws.open.empty()) {
+        auto [f, g, node] = ws.pop();
+        if (g > ws.gScore[node]) {
+            continue;
+        }
+        if (isGoal(node)) {
+            ws.trace(node);
+            ws.end();
+            return node;
+        }
+        ws.expanded += 1;
+
+        const Vec2I p = grid.pos(node);
+        for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+            const Dir&  d      = DIRS[std::countr_zero(m)];
+            const Vec2I next   = {p.x + d.dx, p.y + d.dy};
+            const int   nextId = grid.index(next);
+            const int   nextG  = g + grid.stepCost(next, d.cost);
+            if (nextG >= ws.g(nextId)) {
+                continue;
+            }
+            ws.reach(nextId, nextG, node);
+            ws.push({nextG, nextG, nextId});
+        }
+    }
+    ws.end();
+    return -1;
+}
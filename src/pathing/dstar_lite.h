@@ -0,0 +1,250 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <functional>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+// D* Lite (Koenig & Likhachev). Searches backwards from the goal so the
+// agent can keep moving its start along the path, and repairs only the part
+// of the search affected when tiles change. State is kept sparse since one
+// planner exists per moving agent.
+struct DStarLite {
+    static constexpr int INF = INT_MAX / 2;
+
+    struct Key {
+        int k1;
+        int k2;
+
+        auto operator<=>(const Key&) const = default;
+    };
+
+    struct Node {
+        int  g      = INF;
+        int  rhs    = INF;
+        bool queued = false;
+        Key  key    = {};
+    };
+
+    struct Entry {
+        Key key;
+        int node;
+
+        bool operator>(const Entry& other) const {
+            return other.key < key;
+        }
+    };
+
+    int                           start = -1;
+    int                           goal  = -1;
+    int                           last  = -1;
+    int                           km    = 0;
+    int                           width = 0;
+    std::unordered_map<int, Node> nodes;
+    // Bounding box of every tile in `nodes`
+    Rect touched = {{INT_MAX, INT_MAX}, {INT_MIN, INT_MIN}};
+    std::vector<Entry>            open;
+    uint64_t                      expanded = 0;
+
+    void init(GridView grid, int from, int to) {
+        nodes.clear();
+        open.clear();
+        touched      = {{INT_MAX, INT_MAX}, {INT_MIN, INT_MIN}};
+        width        = grid.dim.x;
+        start = last = from;
+        goal         = to;
+        km           = 0;
+        Node& g      = nodes[goal];
+        g.rhs        = 0;
+        push(grid, goal, g);
+    }
+
+    // The agent moved; keys already queued stay valid by bumping km
+    void moveStart(GridView grid, int from) {
+        km += grid.heuristic(grid.pos(last), grid.pos(from));
+        start = last = from;
+    }
+
+    // Whether an edit at `p` can reach any tile this search has looked at.
+    // An edit changes the tiles around it, whose rhs reads their neighbours.
+    bool affectedBy(Vec2I p) const {
+        return p.x >= touched.min.x - 2 && p.x < touched.max.x + 2 &&
+               p.y >= touched.min.y - 2 && p.y < touched.max.y + 2;
+    }
+
+    // Tile `i` changed walkability. That changes edges to `i` and, through
+    // the corner-cutting rule, diagonal edges between its neighbours.
+    // Tiles the search never reached stay at g = rhs = INF and are skipped,
+    // so edits elsewhere on the map add no state.
+    void tileChanged(GridView grid, int i) {
+        const Vec2I p = grid.pos(i);
+        refresh(grid, i);
+        for (const Dir& d : DIRS) {
+            const Vec2I n = {p.x + d.dx, p.y + d.dy};
+            if (grid.bounds.contains(n)) {
+                refresh(grid, grid.index(n));
+            }
+        }
+    }
+
+    // Repair the search, then write the path from `start` (exclusive) to
+    // `goal` into `out`
+    bool plan(GridView grid, std::vector<int>& out) {
+        out.clear();
+        computeShortestPath(grid);
+        if (node(start).rhs >= INF) {
+            return false;
+        }
+
+        int current = start;
+        for (int steps = 0; current != goal; ++steps) {
+            if (steps > grid.size()) {
+                return false;
+            }
+            const Vec2I p    = grid.pos(current);
+            int         best = -1;
+            int         cost = INF;
+            for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+                const Dir&  d    = DIRS[std::countr_zero(m)];
+                const Vec2I next = {p.x + d.dx, p.y + d.dy};
+                const int   n    = grid.index(next);
+                const int   c    = grid.stepCost(next, d.cost) + node(n).g;
+                if (c < cost) {
+                    cost = c;
+                    best = n;
+                }
+            }
+            if (best == -1 || cost >= INF) {
+                return false;
+            }
+            SearchWorkspace::grow(out);
+            out.push_back(best);
+            current = best;
+        }
+        return true;
+    }
+
+   private:
+    Node& node(int i) {
+        auto [it, inserted] = nodes.try_emplace(i);
+        if (inserted) {
+            const int x = i % width;
+            const int y = i / width;
+            touched.min = {
+                std::min(touched.min.x, x), std::min(touched.min.y, y)
+            };
+            touched.max = {
+                std::max(touched.max.x, x + 1), std::max(touched.max.y, y + 1)
+            };
+        }
+        return it->second;
+    }
+
+    // update() for an edited tile, without creating state for one that is
+    // unknown and whose neighbours are all unsearched: its rhs stays INF
+    void refresh(GridView grid, int i) {
+        if (!nodes.contains(i)) {
+            const Vec2I p       = grid.pos(i);
+            bool        reached = false;
+            for (uint8_t m = grid.moves(p); m && !reached; m &= m - 1) {
+                const Dir& d = DIRS[std::countr_zero(m)];
+                const auto it =
+                    nodes.find(grid.index({p.x + d.dx, p.y + d.dy}));
+                reached = it != nodes.end() && it->second.g < INF;
+            }
+            if (!reached) {
+                return;
+            }
+        }
+        update(grid, i);
+    }
+
+    Key keyOf(GridView grid, const Node& n, int i) const {
+        const int m = std::min(n.g, n.rhs);
+        return {m + grid.heuristic(grid.pos(start), grid.pos(i)) + km, m};
+    }
+
+    void push(GridView grid, int i, Node& n) {
+        n.queued = true;
+        n.key    = keyOf(grid, n, i);
+        open.push_back({n.key, i});
+        std::push_heap(open.begin(), open.end(), std::greater<>{});
+    }
+
+    // Drop stale heap entries left behind by lazy removal
+    void prune() {
+        while (!open.empty()) {
+            const Entry& top = open.front();
+            auto         it  = nodes.find(top.node);
+            if (it->second.queued && it->second.key == top.key) {
+                return;
+            }
+            std::pop_heap(open.begin(), open.end(), std::greater<>{});
+            open.pop_back();
+        }
+    }
+
+    void update(GridView grid, int i) {
+        Node& n = node(i);
+        if (i != goal) {
+            n.rhs         = INF;
+            const Vec2I p = grid.pos(i);
+            for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+                const Dir&  d    = DIRS[std::countr_zero(m)];
+                const Vec2I next = {p.x + d.dx, p.y + d.dy};
+                const int   cost = grid.stepCost(next, d.cost);
+                const int   via  = cost + node(grid.index(next)).g;
+                n.rhs            = std::min(n.rhs, via);
+            }
+        }
+        n.queued = false;
+        if (n.g != n.rhs) {
+            push(grid, i, n);
+        }
+    }
+
+    void updateNeighbours(GridView grid, int i) {
+        const Vec2I p = grid.pos(i);
+        for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+            const Dir& d = DIRS[std::countr_zero(m)];
+            update(grid, grid.index({p.x + d.dx, p.y + d.dy}));
+        }
+    }
+
+    void computeShortestPath(GridView grid) {
+        while (true) {
+            prune();
+            Node&     s      = node(start);
+            const Key target = keyOf(grid, s, start);
+            const bool settled = open.empty() || !(open.front().key < target);
+            if (settled && s.rhs == s.g) {
+                return;
+            }
+
+            const Entry top = open.front();
+            std::pop_heap(open.begin(), open.end(), std::greater<>{});
+            open.pop_back();
+
+            Node&     u      = node(top.node);
+            const Key newKey = keyOf(grid, u, top.node);
+            u.queued         = false;
+            expanded += 1;
+            if (top.key < newKey) {
+                push(grid, top.node, u);
+            } else if (u.g > u.rhs) {
+                u.g = u.rhs;
+                updateNeighbours(grid, top.node);
+            } else {
+                u.g = INF;
+                update(grid, top.node);
+                updateNeighbours(grid, top.node);
+            }
+        }
+    }
+};
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+// Distance map toward a fixed set of goal tiles, built with one multi-source
+// Dijkstra. Moves are symmetric, so the forward search from the goals gives
+// every tile its cost to the nearest goal and the first step to take.
+struct FlowField {
+    static constexpr uint8_t AT_GOAL     = 8;
+    static constexpr uint8_t UNREACHABLE = 255;
+
+    Vec2I                 dim;
+    std::vector<int>      goals;
+    std::vector<int>      dist;
+    std::vector<uint8_t>  step;    // index into DIRS toward the nearest goal
+    std::vector<uint16_t> source;  // index into goals of the nearest goal
+    uint32_t              revision = 0;
+
+    void build(GridView grid, uint32_t rev) {
+        struct Entry {
+            int d;
+            int node;
+        };
+
+        dim      = grid.dim;
+        revision = rev;
+        dist.assign(grid.size(), INT_MAX);
+        step.assign(grid.size(), UNREACHABLE);
+        source.assign(grid.size(), 0);
+
+        static thread_local RadixHeap<Entry> open;
+        open.clear();
+        for (int i = 0; i < static_cast<int>(goals.size()); ++i) {
+            const int g = goals[i];
+            if (!grid.walkable(grid.pos(g)) || dist[g] == 0) {
+                continue;
+            }
+            dist[g]   = 0;
+            step[g]   = AT_GOAL;
+            source[g] = static_cast<uint16_t>(i);
+            open.push(0, {0, g});
+        }
+
+        while (!open.empty()) {
+            auto [d, node] = open.pop();
+            if (d > dist[node]) {
+                continue;
+            }
+            // Walkers step from the neighbour onto `p`, so `p` sets the cost
+            const Vec2I p = grid.pos(node);
+            for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+                const int  k     = std::countr_zero(m);
+                const Dir& dir   = DIRS[k];
+                const int  next  = grid.index({p.x + dir.dx, p.y + dir.dy});
+                const int  nextD = d + grid.stepCost(p, dir.cost);
+                if (nextD >= dist[next]) {
+                    continue;
+                }
+                dist[next] = nextD;
+                // Walking back is the opposite direction, 4 codes around
+                step[next]   = static_cast<uint8_t>((k + 4) % 8);
+                source[next] = source[node];
+                open.push(nextD, {nextD, next});
+            }
+        }
+    }
+
+    int index(Vec2I p) const {
+        return p.y * dim.x + p.x;
+    }
+
+    bool reachable(Vec2I p) const {
+        return step[index(p)] != UNREACHABLE;
+    }
+
+    int distance(Vec2I p) const {
+        return dist[index(p)];
+    }
+
+    // Goal this tile drains toward; only meaningful if reachable
+    Vec2I goalFor(Vec2I p) const {
+        const int g = goals[source[index(p)]];
+        return {g % dim.x, g / dim.x};
+    }
+
+    // Next tile on the way to the nearest goal
+    std::optional<Vec2I> next(Vec2I p) const {
+        const uint8_t code = step[index(p)];
+        if (code == UNREACHABLE || code == AT_GOAL) {
+            return std::nullopt;
+        }
+        return Vec2I{p.x + DIRS[code].dx, p.y + DIRS[code].dy};
+    }
+};
+
+// Flow fields keyed by their goal set. A field is rebuilt on lookup if the
+// grid revision moved on since it was built.
+struct FlowFieldCache {
+    std::vector<FlowField> fields;
+
+    const FlowField&
+    get(GridView grid, const std::vector<int>& goals, uint32_t revision) {
+        for (FlowField& field : fields) {
+            if (field.goals == goals) {
+                if (field.revision != revision) {
+                    field.build(grid, revision);
+                }
+                return field;
+            }
+        }
+        FlowField& field = fields.emplace_back();
+        field.goals      = goals;
+        field.build(grid, revision);
+        return field;
+    }
+
+    // Field whose goals include `goal`, rebuilt first if it is out of date.
+    // Null if no field toward `goal` was ever asked for.
+    const FlowField* find(GridView grid, int goal, uint32_t revision) {
+        for (FlowField& field : fields) {
+            if (std::find(field.goals.begin(), field.goals.end(), goal) !=
+                field.goals.end()) {
+                if (field.revision != revision) {
+                    field.build(grid, revision);
+                }
+                return &field;
+            }
+        }
+        return nullptr;
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+
+#include "../utils/vectors.h"
+#include "bit_grid.h"
+
+/**** Moves ****/
+
+// Grid searches are 8-connected. Straight steps cost 10 and diagonal steps 14
+// so costs stay integral and the octile heuristic is exact on open ground.
+constexpr int STRAIGHT_COST = 10;
+constexpr int DIAGONAL_COST = 14;
+// Terrain weight of plain ground. Entering a tile of weight w costs w /
+// TERRAIN_UNIT times the step cost, so roads go below it and mud above.
+constexpr int TERRAIN_UNIT = 10;
+
+struct Dir {
+    int dx;
+    int dy;
+    int cost;
+};
+
+// Ordered clockwise from north; the index doubles as a 3-bit direction code
+constexpr std::array<Dir, 8> DIRS = {{
+    {0, -1, STRAIGHT_COST},
+    {1, -1, DIAGONAL_COST},
+    {1, 0, STRAIGHT_COST},
+    {1, 1, DIAGONAL_COST},
+    {0, 1, STRAIGHT_COST},
+    {-1, 1, DIAGONAL_COST},
+    {-1, 0, STRAIGHT_COST},
+    {-1, -1, DIAGONAL_COST},
+}};
+
+// Legal moves for every 3x3 window (see BitGrid::window) as a mask over DIRS,
+// with the same no-corner-cutting rule as GridView::canStep
+constexpr std::array<uint8_t, 512> MOVES = [] {
+    std::array<uint8_t, 512> moves = {};
+    for (int w = 0; w < 512; ++w) {
+        auto open = [w](int dx, int dy) {
+            return (w >> ((dy + 1) * 3 + (dx + 1))) & 1;
+        };
+        for (int k = 0; k < 8; ++k) {
+            const Dir& d        = DIRS[k];
+            const bool diagonal = d.dx != 0 && d.dy != 0;
+            if (open(d.dx, d.dy) &&
+                (!diagonal || (open(d.dx, 0) && open(0, d.dy)))) {
+                moves[w] |= 1 << k;
+            }
+        }
+    }
+    return moves;
+}();
+
+int octile(Vec2I a, Vec2I b) {
+    const int dx = std::abs(a.x - b.x);
+    const int dy = std::abs(a.y - b.y);
+    return STRAIGHT_COST * std::max(dx, dy) +
+           (DIAGONAL_COST - STRAIGHT_COST) * std::min(dx, dy);
+}
+
+/**** Grid View ****/
+
+struct Rect {
+    Vec2I min;
+    Vec2I max;  // exclusive
+
+    bool contains(Vec2I p) const {
+        return p.x >= min.x && p.x < max.x && p.y >= min.y && p.y < max.y;
+    }
+};
+
+// Read-only view of a walkability grid: a set bit is walkable. Tiles outside
+// `bounds` read as blocked, which lets a search be confined to a
+// sub-rectangle without copying the grid. Without a terrain layer every tile
+// has weight TERRAIN_UNIT.
+struct GridView {
+    const BitGrid* cells;
+    Vec2I          dim;
+    Rect           bounds;
+    const uint8_t* terrain    = nullptr;  // per-tile weight, row-major
+    int            minTerrain = TERRAIN_UNIT;
+
+    explicit GridView(
+        const BitGrid& cells,
+        const uint8_t* terrain    = nullptr,
+        int            minTerrain = TERRAIN_UNIT
+    )
+        : cells(&cells)
+        , dim(cells.dim)
+        , bounds{{0, 0}, cells.dim}
+        , terrain(terrain)
+        , minTerrain(minTerrain) {}
+
+    GridView within(Rect r) const {
+        GridView v = *this;
+        v.bounds   = {
+            {std::max(r.min.x, 0), std::max(r.min.y, 0)},
+            {std::min(r.max.x, dim.x), std::min(r.max.y, dim.y)}
+        };
+        return v;
+    }
+
+    int size() const {
+        return dim.x * dim.y;
+    }
+
+    int index(Vec2I p) const {
+        return p.y * dim.x + p.x;
+    }
+
+    Vec2I pos(int i) const {
+        return {i % dim.x, i / dim.x};
+    }
+
+    bool walkable(int x, int y) const {
+        return x >= bounds.min.x && x < bounds.max.x && y >= bounds.min.y &&
+               y < bounds.max.y && cells->get(x, y);
+    }
+
+    bool walkable(Vec2I p) const {
+        return walkable(p.x, p.y);
+    }
+
+    // A step is legal if the destination is walkable and, for diagonals, both
+    // orthogonal tiles are too. Workers never cut across a water corner.
+    bool canStep(Vec2I from, const Dir& d) const {
+        if (!walkable(from.x + d.dx, from.y + d.dy)) {
+            return false;
+        }
+        if (d.dx != 0 && d.dy != 0) {
+            return walkable(from.x + d.dx, from.y) &&
+                   walkable(from.x, from.y + d.dy);
+        }
+        return true;
+    }
+
+    // Cost of stepping onto `to` with a move whose flat cost is `base`
+    int stepCost(Vec2I to, int base) const {
+        if (!terrain) {
+            return base;
+        }
+        return base * terrain[index(to)] / TERRAIN_UNIT;
+    }
+
+    // Octile distance with each step priced as stepCost would on the
+    // cheapest terrain. Pricing the steps after the same rounding keeps it
+    // consistent, so f never drops along a path.
+    int heuristic(Vec2I a, Vec2I b) const {
+        if (!terrain) {
+            return octile(a, b);
+        }
+        const int dx       = std::abs(a.x - b.x);
+        const int dy       = std::abs(a.y - b.y);
+        const int straight = STRAIGHT_COST * minTerrain / TERRAIN_UNIT;
+        const int diagonal = DIAGONAL_COST * minTerrain / TERRAIN_UNIT;
+        return straight * (std::max(dx, dy) - std::min(dx, dy)) +
+               diagonal * std::min(dx, dy);
+    }
+
+    // Every legal step out of `p` as a mask over DIRS, from one read of the
+    // surrounding words instead of a load per neighbour. Iterate with
+    // `for (m = moves(p); m; m &= m - 1) DIRS[std::countr_zero(m)]`.
+    uint8_t moves(Vec2I p) const {
+        uint16_t w = cells->window(p);
+        if (p.x - 1 < bounds.min.x) w &= ~0b001001001;
+        if (p.x + 1 >= bounds.max.x) w &= ~0b100100100;
+        if (p.y - 1 < bounds.min.y) w &= ~0b000000111;
+        if (p.y + 1 >= bounds.max.y) w &= ~0b111000000;
+        return MOVES[w];
+    }
+};
@@ -0,0 +1,373 @@
+#pragma once
+
+#include <unordered_map>
+#include <vector>
+
+#include "astar.h"
+#include "dijkstra.h"
+
+// Hierarchical A* (HPA*). The grid is cut into square clusters; abstract
+// nodes sit on both sides of every entrance between neighbouring clusters and
+// are linked by inter-cluster steps and precomputed intra-cluster costs. Long
+// queries search this small graph and only refine the first few segments
+// back into tiles.
+struct HpaGraph {
+    struct Edge {
+        int to;
+        int cost;
+    };
+
+    // Entrances at least this wide get a transition at each end instead of
+    // one in the middle
+    static constexpr int WIDE_ENTRANCE = 6;
+
+    int                            clusterSize;
+    Vec2I                          clusterDim;
+    std::vector<int>               nodeTile;  // -1 for a free node id
+    std::vector<std::vector<Edge>> edges;
+    std::vector<std::vector<int>>  clusterNodes;
+    std::vector<int>               freeNodes;
+
+    static HpaGraph build(GridView grid, int clusterSize) {
+        HpaGraph h;
+        h.clusterSize = clusterSize;
+        h.clusterDim  = {
+            (grid.dim.x + clusterSize - 1) / clusterSize,
+            (grid.dim.y + clusterSize - 1) / clusterSize
+        };
+        h.clusterNodes.resize(h.clusterDim.x * h.clusterDim.y);
+
+        for (int c = 0; c < static_cast<int>(h.clusterNodes.size()); ++c) {
+            h.scanBorders(grid, c);
+        }
+        for (int c = 0; c < static_cast<int>(h.clusterNodes.size()); ++c) {
+            h.linkCluster(grid, c);
+        }
+        return h;
+    }
+
+    // Bring the graph up to date after the tile at `p` changed. Only the
+    // entrances on the borders of its cluster can move, so those are scanned
+    // again, and only that cluster and the neighbours across those borders
+    // need their intra-cluster costs redone.
+    void update(GridView grid, Vec2I p) {
+        const int        c = clusterOf(p);
+        const Vec2I      cc = {c % clusterDim.x, c / clusterDim.x};
+        std::vector<int> neighbours;
+        if (cc.x > 0) {
+            neighbours.push_back(c - 1);
+        }
+        if (cc.x + 1 < clusterDim.x) {
+            neighbours.push_back(c + 1);
+        }
+        if (cc.y > 0) {
+            neighbours.push_back(c - clusterDim.x);
+        }
+        if (cc.y + 1 < clusterDim.y) {
+            neighbours.push_back(c + clusterDim.x);
+        }
+        auto clusterOfNode = [&](int n) {
+            return clusterOf(grid.pos(nodeTile[n]));
+        };
+
+        // Every node of the cluster sits on one of its borders, all of which
+        // are scanned again below
+        for (int n : clusterNodes[c]) {
+            for (Edge e : edges[n]) {
+                if (clusterOfNode(e.to) != c) {
+                    std::erase_if(edges[e.to], [n](Edge back) {
+                        return back.to == n;
+                    });
+                }
+            }
+            freeNode(n);
+        }
+        clusterNodes[c].clear();
+
+        // Neighbour nodes left without a transition only served this one
+        for (int nb : neighbours) {
+            for (int n : clusterNodes[nb]) {
+                std::erase_if(edges[n], [&](Edge e) {
+                    return clusterOfNode(e.to) == nb;
+                });
+            }
+            std::erase_if(clusterNodes[nb], [&](int n) {
+                if (!edges[n].empty()) {
+                    return false;
+                }
+                freeNode(n);
+                return true;
+            });
+        }
+
+        scanBorders(grid, c);
+        if (cc.x > 0) {
+            scanBorders(grid, c - 1, true, false);
+        }
+        if (cc.y > 0) {
+            scanBorders(grid, c - clusterDim.x, false, true);
+        }
+        linkCluster(grid, c);
+        for (int nb : neighbours) {
+            linkCluster(grid, nb);
+        }
+    }
+
+    int clusterOf(Vec2I p) const {
+        return (p.y / clusterSize) * clusterDim.x + p.x / clusterSize;
+    }
+
+    Rect clusterRect(GridView grid, int cluster) const {
+        const Vec2I c   = {cluster % clusterDim.x, cluster / clusterDim.x};
+        const Vec2I min = c * clusterSize;
+        return {
+            min,
+            {std::min(min.x + clusterSize, grid.dim.x),
+             std::min(min.y + clusterSize, grid.dim.y)}
+        };
+    }
+
+    // Find a path from `start` to `goal`, refining at most `maxSegments`
+    // intra-cluster hops into tiles. The tiles (excluding start) are written
+    // to `out`; if the path was cut short the last tile is not `goal` and the
+    // caller should query again from there once it gets close.
+    bool find(
+        GridView          grid,
+        int               start,
+        int               goal,
+        int               maxSegments,
+        std::vector<int>& out
+    ) const {
+        out.clear();
+        SearchWorkspace& ws  = searchWorkspace;
+        const Vec2I      s   = grid.pos(start);
+        const Vec2I      t   = grid.pos(goal);
+        const int        sc  = clusterOf(s);
+        const int        gc  = clusterOf(t);
+
+        if (sc == gc &&
+            astarSearch(grid.within(clusterRect(grid, sc)), start, goal, ws)) {
+            out.assign(ws.path.begin(), ws.path.end());
+            return true;
+        }
+
+        // Costs from the start and to the goal for nodes in their clusters
+        Scratch& scratch = hpaScratch;
+        scratch.startCosts.clear();
+        scratch.goalCosts.clear();
+        dijkstraFlood(grid.within(clusterRect(grid, sc)), start, ws);
+        for (int n : clusterNodes[sc]) {
+            if (ws.seen(nodeTile[n])) {
+                scratch.startCosts.push_back({n, ws.gScore[nodeTile[n]]});
+            }
+        }
+        dijkstraFlood(grid.within(clusterRect(grid, gc)), goal, ws);
+        for (int n : clusterNodes[gc]) {
+            if (ws.seen(nodeTile[n])) {
+                scratch.goalCosts.push_back({n, ws.gScore[nodeTile[n]]});
+            }
+        }
+        if (scratch.startCosts.empty() || scratch.goalCosts.empty()) {
+            return false;
+        }
+
+        if (!searchAbstract(grid, t, scratch)) {
+            return false;
+        }
+        return refine(
+            grid, start, goal, maxSegments, scratch.abstract.path, out
+        );
+    }
+
+   private:
+    struct Scratch {
+        SearchWorkspace   abstract;
+        std::vector<Edge> startCosts;
+        std::vector<Edge> goalCosts;
+    };
+    static inline thread_local Scratch hpaScratch;
+
+    // The node on tile `p`, added to its cluster if there is none yet
+    int nodeAt(GridView grid, Vec2I p) {
+        const int         tile  = grid.index(p);
+        std::vector<int>& nodes = clusterNodes[clusterOf(p)];
+        for (int n : nodes) {
+            if (nodeTile[n] == tile) {
+                return n;
+            }
+        }
+        int n;
+        if (freeNodes.empty()) {
+            n = static_cast<int>(nodeTile.size());
+            nodeTile.push_back(tile);
+            edges.emplace_back();
+        } else {
+            n = freeNodes.back();
+            freeNodes.pop_back();
+            nodeTile[n] = tile;
+        }
+        nodes.push_back(n);
+        return n;
+    }
+
+    void freeNode(int n) {
+        nodeTile[n] = -1;
+        edges[n].clear();
+        freeNodes.push_back(n);
+    }
+
+    void transition(GridView grid, Vec2I a, Vec2I b) {
+        const int na = nodeAt(grid, a);
+        const int nb = nodeAt(grid, b);
+        edges[na].push_back({nb, grid.stepCost(b, STRAIGHT_COST)});
+        edges[nb].push_back({na, grid.stepCost(a, STRAIGHT_COST)});
+    }
+
+    // Scan one border between two clusters. `a` walks the near side, `step`
+    // moves along the border and `across` crosses it.
+    void scanBorder(GridView grid, Vec2I a, Vec2I step, Vec2I across, int len) {
+        int runStart = -1;
+        for (int i = 0; i <= len; ++i) {
+            const Vec2I p    = a + step * i;
+            const bool  open = i < len && grid.walkable(p) &&
+                              grid.walkable(p + across);
+            if (open && runStart < 0) {
+                runStart = i;
+            } else if (!open && runStart >= 0) {
+                const int runEnd = i - 1;
+                if (runEnd - runStart + 1 >= WIDE_ENTRANCE) {
+                    const Vec2I first = a + step * runStart;
+                    const Vec2I last  = a + step * runEnd;
+                    transition(grid, first, first + across);
+                    transition(grid, last, last + across);
+                } else {
+                    const Vec2I m = a + step * ((runStart + runEnd) / 2);
+                    transition(grid, m, m + across);
+                }
+                runStart = -1;
+            }
+        }
+    }
+
+    // Entrances on the east and south borders of `cluster`. Its west and
+    // north borders are the east and south borders of its neighbours.
+    void scanBorders(
+        GridView grid, int cluster, bool east = true, bool south = true
+    ) {
+        const Rect r = clusterRect(grid, cluster);
+        if (east && r.max.x < grid.dim.x) {
+            scanBorder(
+                grid, {r.max.x - 1, r.min.y}, {0, 1}, {1, 0}, r.max.y - r.min.y
+            );
+        }
+        if (south && r.max.y < grid.dim.y) {
+            scanBorder(
+                grid, {r.min.x, r.max.y - 1}, {1, 0}, {0, 1}, r.max.x - r.min.x
+            );
+        }
+    }
+
+    // Intra-cluster edges between every pair of nodes in `cluster` that can
+    // reach each other without leaving it
+    void linkCluster(GridView grid, int cluster) {
+        SearchWorkspace& ws    = searchWorkspace;
+        const GridView   local = grid.within(clusterRect(grid, cluster));
+        for (int from : clusterNodes[cluster]) {
+            dijkstraFlood(local, nodeTile[from], ws);
+            for (int to : clusterNodes[cluster]) {
+                if (to != from && ws.seen(nodeTile[to])) {
+                    edges[from].push_back({to, ws.gScore[nodeTile[to]]});
+                }
+            }
+        }
+    }
+
+    // A* over the abstract graph. Two virtual nodes are appended: the start
+    // and the goal, wired up through the precomputed cluster costs.
+    bool searchAbstract(GridView grid, Vec2I goalPos, Scratch& scratch) const {
+        SearchWorkspace& ws        = scratch.abstract;
+        const int        startNode = static_cast<int>(nodeTile.size());
+        const int        goalNode  = startNode + 1;
+        auto             h         = [&](int n) {
+            if (n == goalNode) {
+                return 0;
+            }
+            return grid.heuristic(grid.pos(nodeTile[n]), goalPos);
+        };
+        auto relax = [&](int from, int g, Edge e) {
+            const int nextG = g + e.cost;
+            if (nextG < ws.g(e.to)) {
+                ws.reach(e.to, nextG, from);
+                ws.push({nextG + h(e.to), nextG, e.to});
+            }
+        };
+
+        ws.begin(goalNode + 1);
+        ws.reach(startNode, 0, -1);
+        for (Edge e : scratch.startCosts) {
+            relax(startNode, 0, e);
+        }
+        while (!ws.open.empty()) {
+            auto [f, g, node] = ws.pop();
+            if (g > ws.gScore[node]) {
+                continue;
+            }
+            if (node == goalNode) {
+                ws.trace(goalNode);
+                ws.path.pop_back();  // drop the virtual goal
+                ws.end();
+                return true;
+            }
+            ws.expanded += 1;
+            for (Edge e : edges[node]) {
+                relax(node, g, e);
+            }
+            for (Edge e : scratch.goalCosts) {
+                if (e.to == node) {
+                    relax(node, g, {goalNode, e.cost});
+                }
+            }
+        }
+        ws.end();
+        return false;
+    }
+
+    // Turn abstract nodes back into tiles, one cluster-local A* per hop
+    bool refine(
+        GridView                grid,
+        int                     start,
+        int                     goal,
+        int                     maxSegments,
+        const std::vector<int>& waypoints,
+        std::vector<int>&       out
+    ) const {
+        SearchWorkspace& ws       = searchWorkspace;
+        int              from     = start;
+        int              segments = 0;
+        for (size_t i = 0; i <= waypoints.size(); ++i) {
+            const int to = i < waypoints.size() ? nodeTile[waypoints[i]] : goal;
+            if (to == from) {
+                continue;
+            }
+            const int cluster = clusterOf(grid.pos(from));
+            if (cluster != clusterOf(grid.pos(to))) {
+                // Only entrance transitions cross a border, and those are a
+                // single straight step
+                out.push_back(to);
+            } else {
+                if (segments == maxSegments) {
+                    return true;
+                }
+                if (!astarSearch(
+                        grid.within(clusterRect(grid, cluster)), from, to, ws
+                    )) {
+                    return false;
+                }
+                out.insert(out.end(), ws.path.begin(), ws.path.end());
+                segments += 1;
+            }
+            from = to;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <bit>
+
+#include "grid.h"
+#include "search_workspace.h"
+
+// Jump Point Search for uniform-cost grids. Straight and diagonal runs are
+// skipped over until a tile with a forced neighbour turns up, so only those
+// jump points ever enter the open list. Uses the same no-corner-cutting rule
+// as GridView::canStep, which keeps results interchangeable with astarSearch.
+
+namespace jps {
+
+// Walk from (x, y) in direction (dx, dy) until a jump point, the goal or a
+// dead end. Returns the node index of the jump point or -1.
+int jump(GridView grid, int x, int y, int dx, int dy, Vec2I goal) {
+    while (true) {
+        if (!grid.walkable(x, y)) {
+            return -1;
+        }
+        if (x == goal.x && y == goal.y) {
+            return grid.index({x, y});
+        }
+        if (dx != 0 && dy != 0) {
+            // Diagonal moves stop wherever a straight run finds something
+            if (jump(grid, x + dx, y, dx, 0, goal) != -1 ||
+                jump(grid, x, y + dy, 0, dy, goal) != -1) {
+                return grid.index({x, y});
+            }
+            if (!grid.walkable(x + dx, y) || !grid.walkable(x, y + dy)) {
+                return -1;
+            }
+        } else if (dx != 0) {
+            if ((grid.walkable(x, y - 1) && !grid.walkable(x - dx, y - 1)) ||
+                (grid.walkable(x, y + 1) && !grid.walkable(x - dx, y + 1))) {
+                return grid.index({x, y});
+            }
+        } else {
+            if ((grid.walkable(x - 1, y) && !grid.walkable(x - 1, y - dy)) ||
+                (grid.walkable(x + 1, y) && !grid.walkable(x + 1, y - dy))) {
+                return grid.index({x, y});
+            }
+        }
+        x += dx;
+        y += dy;
+    }
+}
+
+// Directions worth exploring from `p` given the direction we arrived in
+template <typename Fn>
+void prunedNeighbours(GridView grid, Vec2I p, Vec2I from, Fn&& fn) {
+    if (from == p) {
+        for (uint8_t m = grid.moves(p); m; m &= m - 1) {
+            const Dir& d = DIRS[std::countr_zero(m)];
+            fn(d.dx, d.dy);
+        }
+        return;
+    }
+
+    const int dx = (p.x > from.x) - (p.x < from.x);
+    const int dy = (p.y > from.y) - (p.y < from.y);
+    if (dx != 0 && dy != 0) {
+        const bool vertical   = grid.walkable(p.x, p.y + dy);
+        const bool horizontal = grid.walkable(p.x + dx, p.y);
+        if (vertical) fn(0, dy);
+        if (horizontal) fn(dx, 0);
+        if (vertical && horizontal) fn(dx, dy);
+    } else if (dx != 0) {
+        const bool next  = grid.walkable(p.x + dx, p.y);
+        const bool below = grid.walkable(p.x, p.y + 1);
+        const bool above = grid.walkable(p.x, p.y - 1);
+        if (next) {
+            fn(dx, 0);
+            if (below) fn(dx, 1);
+            if (above) fn(dx, -1);
+        }
+        if (below) fn(0, 1);
+        if (above) fn(0, -1);
+    } else {
+        const bool next  = grid.walkable(p.x, p.y + dy);
+        const bool right = grid.walkable(p.x + 1, p.y);
+        const bool left  = grid.walkable(p.x - 1, p.y);
+        if (next) {
+            fn(0, dy);
+            if (right) fn(1, dy);
+            if (left) fn(-1, dy);
+        }
+        if (right) fn(1, 0);
+        if (left) fn(-1, 0);
+    }
+}
+
+}  // namespace jps
+
+// Same contract as astarSearch: on success `ws.path` holds every tile from
+// the step after `start` up to and including `goal`.
+bool jpsSearch(GridView grid, int start, int goal, SearchWorkspace& ws) {
+    ws.begin(grid.size());
+    if (!grid.walkable(grid.pos(goal))) {
+        ws.end();
+        return false;
+    }
+
+    const Vec2I goalPos = grid.pos(goal);
+    ws.reach(start, 0, -1);
+    ws.push({octile(grid.pos(start), goalPos), 0, start});
+
+    bool found = false;
+    while (!ws.open.empty()) {
+        auto [f, g, node] = ws.pop();
+        if (g > ws.gScore[node]) {
+            continue;
+        }
+        if (node == goal) {
+            ws.trace(goal);
+            found = true;
+            break;
+        }
+        ws.expanded += 1;
+
+        const int   parent = ws.parent[node];
+        const Vec2I p      = grid.pos(node);
+        const Vec2I from   = parent == -1 ? p : grid.pos(parent);
+        jps::prunedNeighbours(grid, p, from, [&](int dx, int dy) {
+            const int jp = jps::jump(grid, p.x + dx, p.y + dy, dx, dy, goalPos);
+            if (jp == -1) {
+                return;
+            }
+            const Vec2I next  = grid.pos(jp);
+            const int   nextG = g + octile(p, next);
+            if (nextG >= ws.g(jp)) {
+                return;
+            }
+            ws.reach(jp, nextG, node);
+            ws.push({nextG + octile(next, goalPos), nextG, jp});
+        });
+    }
+    ws.end();
+    if (!found) {
+        return false;
+    }
+
+    // Jump points are joined by straight or diagonal runs; fill them back in
+    // since workers step one tile at a time
+    if (ws.waypoints.capacity() < ws.path.size()) {
+        pathStats.allocations += 1;
+    }
+    ws.waypoints.assign(ws.path.begin(), ws.path.end());
+    ws.path.clear();
+    Vec2I p = grid.pos(start);
+    for (int jp : ws.waypoints) {
+        const Vec2I q  = grid.pos(jp);
+        const int   dx = (q.x > p.x) - (q.x < p.x);
+        const int   dy = (q.y > p.y) - (q.y < p.y);
+        while (p != q) {
+            p += Vec2I(dx, dy);
+            SearchWorkspace::grow(ws.path);
+            ws.path.push_back(grid.index(p));
+        }
+    }
+    return true;
+}
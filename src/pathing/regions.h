@@ -0,0 +1,281 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "grid.h"
+
+// Connected-component labels of the walkable tiles. Diagonal steps need both
+// orthogonal tiles open, so 8-connected reachability is the same as
+// 4-connected and the labelling only has to look at 4 neighbours.
+struct RegionLabels {
+    static constexpr int BLOCKED = 0;
+
+    Vec2I            dim;
+    std::vector<int> label;
+    std::vector<int> regionSize;  // indexed by label, 0 once a label dies
+    std::vector<int> freeLabels;  // dead labels, handed out again first
+
+    void build(GridView grid) {
+        dim = grid.dim;
+        label.assign(grid.size(), BLOCKED);
+        regionSize.assign(1, 0);
+        freeLabels.clear();
+        for (int i = 0; i < grid.size(); ++i) {
+            if (label[i] == BLOCKED && grid.walkable(grid.pos(i))) {
+                flood(grid, i, BLOCKED, newLabel());
+            }
+        }
+    }
+
+    bool reachable(int a, int b) const {
+        return label[a] != BLOCKED && label[a] == label[b];
+    }
+
+    // Keep labels in sync after tile `i` changed. `grid` already reflects the
+    // change. Opening a tile merges the regions around it by relabelling all
+    // but the biggest; closing one only searches if the tile could have been
+    // a bridge, and then only as far as the smaller pieces reach.
+    void update(GridView grid, int i, bool walkable) {
+        if (walkable == (label[i] != BLOCKED)) {
+            return;
+        }
+        if (walkable) {
+            open(grid, i);
+        } else {
+            close(grid, i);
+        }
+    }
+
+   private:
+    struct Scratch {
+        std::vector<uint32_t>         mark;
+        uint32_t                      stamp = 0;
+        std::vector<std::vector<int>> visited;
+        std::vector<int>              queue;
+    };
+    Scratch scratch;
+
+    static inline const std::array<Vec2I, 4> SIDES = {{
+        {0, -1},
+        {1, 0},
+        {0, 1},
+        {-1, 0},
+    }};
+
+    // Reusing dead labels keeps regionSize as long as the most regions the
+    // map has had at once, however many edits it has seen
+    int newLabel() {
+        if (!freeLabels.empty()) {
+            const int l = freeLabels.back();
+            freeLabels.pop_back();
+            return l;
+        }
+        regionSize.push_back(0);
+        return static_cast<int>(regionSize.size()) - 1;
+    }
+
+    void releaseIfEmpty(int l) {
+        if (regionSize[l] == 0) {
+            freeLabels.push_back(l);
+        }
+    }
+
+    // Relabel the `from` region containing `seed` as `to`
+    void flood(GridView grid, int seed, int from, int to) {
+        std::vector<int>& queue = scratch.queue;
+        queue.clear();
+        queue.push_back(seed);
+        label[seed] = to;
+        for (size_t head = 0; head < queue.size(); ++head) {
+            const Vec2I p = grid.pos(queue[head]);
+            for (Vec2I side : SIDES) {
+                const Vec2I n = p + side;
+                if (!grid.walkable(n) || label[grid.index(n)] != from) {
+                    continue;
+                }
+                label[grid.index(n)] = to;
+                queue.push_back(grid.index(n));
+            }
+        }
+        if (from != BLOCKED) {
+            regionSize[from] -= static_cast<int>(queue.size());
+            releaseIfEmpty(from);
+        }
+        regionSize[to] += static_cast<int>(queue.size());
+    }
+
+    void open(GridView grid, int i) {
+        const Vec2I p    = grid.pos(i);
+        int         best = BLOCKED;
+        for (Vec2I side : SIDES) {
+            const Vec2I n = p + side;
+            if (grid.walkable(n) &&
+                regionSize[label[grid.index(n)]] > regionSize[best]) {
+                best = label[grid.index(n)];
+            }
+        }
+        if (best == BLOCKED) {
+            best = newLabel();
+        }
+        label[i] = best;
+        regionSize[best] += 1;
+        for (Vec2I side : SIDES) {
+            const Vec2I n = p + side;
+            if (grid.walkable(n) && label[grid.index(n)] != best) {
+                flood(grid, grid.index(n), label[grid.index(n)], best);
+            }
+        }
+    }
+
+    // The open neighbours of `p` stay connected if the ring of 8 tiles around
+    // it links them without passing through `p`
+    bool ringConnected(GridView grid, Vec2I p) const {
+        static const std::array<Vec2I, 8> RING = {{
+            {0, -1},
+            {1, -1},
+            {1, 0},
+            {1, 1},
+            {0, 1},
+            {-1, 1},
+            {-1, 0},
+            {-1, -1},
+        }};
+        // Count runs of open ring tiles that contain an orthogonal neighbour
+        int first = -1;
+        for (int k = 0; k < 8; ++k) {
+            if (!grid.walkable(p + RING[k])) {
+                first = k;
+                break;
+            }
+        }
+        if (first == -1) {
+            return true;
+        }
+        int  runs       = 0;
+        bool inRun      = false;
+        bool runHasSide = false;
+        for (int step = 1; step <= 8; ++step) {
+            const int  k    = (first + step) % 8;
+            const bool open = grid.walkable(p + RING[k]);
+            if (open) {
+                inRun = true;
+                runHasSide |= k % 2 == 0;
+            } else if (inRun) {
+                runs += runHasSide ? 1 : 0;
+                inRun      = false;
+                runHasSide = false;
+            }
+        }
+        return runs <= 1;
+    }
+
+    void close(GridView grid, int i) {
+        const int   old = label[i];
+        const Vec2I p   = grid.pos(i);
+        label[i]        = BLOCKED;
+        regionSize[old] -= 1;
+        releaseIfEmpty(old);
+        if (ringConnected(grid, p)) {
+            return;
+        }
+
+        // Grow one breadth-first search per open neighbour in lockstep.
+        // Searches that touch are merged; a merged set whose searches all run
+        // dry has been cut off and gets a fresh label. We stop as soon as at
+        // most one set is still growing, which keeps the old label.
+        std::vector<int> seeds;
+        for (Vec2I side : SIDES) {
+            if (grid.walkable(p + side)) {
+                seeds.push_back(grid.index(p + side));
+            }
+        }
+        const int k = static_cast<int>(seeds.size());
+        if (scratch.mark.size() != label.size()) {
+            scratch.mark.assign(label.size(), 0);
+            scratch.stamp = 0;
+        }
+        if (scratch.stamp + k + 1 < scratch.stamp) {
+            std::fill(scratch.mark.begin(), scratch.mark.end(), 0);
+            scratch.stamp = 0;
+        }
+        const uint32_t base = scratch.stamp + 1;
+        scratch.stamp += k;
+        scratch.visited.resize(std::max<size_t>(scratch.visited.size(), k));
+
+        std::array<int, 4>    root;
+        std::array<size_t, 4> head;
+        auto                  find = [&](int g) {
+            while (root[g] != g) g = root[g];
+            return g;
+        };
+        for (int g = 0; g < k; ++g) {
+            root[g] = g;
+            head[g] = 0;
+            scratch.visited[g].assign(1, seeds[g]);
+            scratch.mark[seeds[g]] = base + g;
+        }
+        auto growing = [&](int g) {
+            return head[g] < scratch.visited[g].size();
+        };
+        auto openSets = [&]() {
+            std::array<bool, 4> open = {};
+            int                 n    = 0;
+            for (int g = 0; g < k; ++g) {
+                if (growing(g) && !open[find(g)]) {
+                    open[find(g)] = true;
+                    n += 1;
+                }
+            }
+            return n;
+        };
+
+        while (openSets() > 1) {
+            for (int g = 0; g < k; ++g) {
+                if (!growing(g)) {
+                    continue;
+                }
+                const Vec2I q = grid.pos(scratch.visited[g][head[g]++]);
+                for (Vec2I side : SIDES) {
+                    const Vec2I n = q + side;
+                    if (!grid.walkable(n)) {
+                        continue;
+                    }
+                    const int      ni = grid.index(n);
+                    const uint32_t m  = scratch.mark[ni];
+                    if (m >= base && m < base + k) {
+                        root[find(m - base)] = find(g);
+                    } else {
+                        scratch.mark[ni] = base + g;
+                        scratch.visited[g].push_back(ni);
+                    }
+                }
+            }
+        }
+
+        // The set still growing (or the biggest, if none is) keeps `old`
+        int keep = -1;
+        for (int g = 0; g < k; ++g) {
+            if (growing(g)) {
+                keep = find(g);
+            }
+        }
+        if (keep == -1) {
+            std::array<size_t, 4> size = {};
+            for (int g = 0; g < k; ++g) {
+                size[find(g)] += scratch.visited[g].size();
+            }
+            keep = static_cast<int>(
+                std::max_element(size.begin(), size.begin() + k) - size.begin()
+            );
+        }
+        for (int g = 0; g < k; ++g) {
+            const int r = find(g);
+            if (r != keep && r == g) {
+                flood(grid, seeds[g], old, newLabel());
+            }
+        }
+    }
+};
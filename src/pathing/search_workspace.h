@@ -0,0 +1,190 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+/**** Stats ****/
+
+// Counters shared by every search on every thread. `allocations` moves when
+// a workspace or a caller's result buffer has to grow, so it should stay
+// flat once the simulation has warmed up.
+struct PathStats {
+    std::atomic<uint64_t> queries       = 0;
+    std::atomic<uint64_t> nodesExpanded = 0;
+    std::atomic<uint64_t> allocations   = 0;
+};
+
+PathStats pathStats;
+
+/**** Open List ****/
+
+// Monotone priority queue for integer keys (a radix heap). Every search here
+// pops keys in non-decreasing order, so entries are bucketed by the highest
+// bit in which they differ from the last key popped. A pop only ever moves
+// entries into lower buckets, and there is no comparison-based sifting per
+// push. Equal keys pop newest first, which favours the deepest node on ties.
+template <typename T>
+struct RadixHeap {
+    using Bucket = std::vector<std::pair<uint32_t, T>>;
+
+    std::array<Bucket, 33> buckets;
+    uint32_t               last  = 0;
+    size_t                 count = 0;
+
+    // Keys below the last one popped would be misfiled; a consistent
+    // heuristic never produces them
+    void push(uint32_t key, T value) {
+        assert(key >= last);
+        place({key, std::move(value)});
+        count += 1;
+    }
+
+    T pop() {
+        if (buckets[0].empty()) {
+            size_t i = 1;
+            while (buckets[i].empty()) {
+                i += 1;
+            }
+            last = buckets[i][0].first;
+            for (const auto& [key, value] : buckets[i]) {
+                last = std::min(last, key);
+            }
+            for (auto& entry : buckets[i]) {
+                place(std::move(entry));
+            }
+            buckets[i].clear();
+        }
+        T value = std::move(buckets[0].back().second);
+        buckets[0].pop_back();
+        count -= 1;
+        return value;
+    }
+
+    bool empty() const {
+        return count == 0;
+    }
+
+    void clear() {
+        for (Bucket& b : buckets) {
+            b.clear();
+        }
+        last  = 0;
+        count = 0;
+    }
+
+   private:
+    size_t bucketFor(uint32_t key) const {
+        return key == last ? 0 : 32 - std::countl_zero(key ^ last);
+    }
+
+    void place(std::pair<uint32_t, T> entry) {
+        Bucket& b = buckets[bucketFor(entry.first)];
+        if (b.size() == b.capacity()) {
+            pathStats.allocations += 1;
+        }
+        b.push_back(std::move(entry));
+    }
+};
+
+/**** Workspace ****/
+
+// Scratch memory for one grid search. Visited marks are stamped with a
+// generation number instead of being cleared, so starting a new query costs
+// O(1) and the search itself only touches the nodes it expands.
+struct SearchWorkspace {
+    struct OpenNode {
+        int f;
+        int g;
+        int node;
+    };
+
+    std::vector<int>      gScore;
+    std::vector<int>      parent;
+    std::vector<uint32_t> visited;
+    RadixHeap<OpenNode>   open;  // keyed by f
+    std::vector<int>      path;
+    std::vector<int>      waypoints;  // sparse turning points, e.g. from JPS
+    uint32_t              generation = 0;
+    uint64_t              expanded   = 0;
+
+    // Prepare for a query over a grid with `nodeCount` nodes
+    void begin(int nodeCount) {
+        if (static_cast<int>(visited.size()) < nodeCount) {
+            gScore.resize(nodeCount);
+            parent.resize(nodeCount);
+            visited.assign(nodeCount, 0);
+            generation = 0;
+            pathStats.allocations += 3;
+        }
+        if (++generation == 0) {
+            // Stamps wrapped around; old marks could alias the new generation
+            std::fill(visited.begin(), visited.end(), 0);
+            generation = 1;
+        }
+        open.clear();
+        path.clear();
+        expanded = 0;
+    }
+
+    // Flush per-query counters into the shared stats
+    void end() {
+        pathStats.queries += 1;
+        pathStats.nodesExpanded += expanded;
+    }
+
+    bool seen(int node) const {
+        return visited[node] == generation;
+    }
+
+    int g(int node) const {
+        return seen(node) ? gScore[node] : INT32_MAX;
+    }
+
+    void reach(int node, int g, int from) {
+        visited[node] = generation;
+        gScore[node]  = g;
+        parent[node]  = from;
+    }
+
+    void push(OpenNode n) {
+        open.push(static_cast<uint32_t>(n.f), n);
+    }
+
+    OpenNode pop() {
+        return open.pop();
+    }
+
+    // Walk parents back from `goal` into `path`, excluding the start node
+    void trace(int goal) {
+        for (int n = goal; parent[n] != -1; n = parent[n]) {
+            grow(path);
+            path.push_back(n);
+        }
+        std::reverse(path.begin(), path.end());
+    }
+
+    // Count the reallocation a push_back is about to cause
+    template <typename T>
+    static void grow(const std::vector<T>& v) {
+        if (v.size() == v.capacity()) {
+            pathStats.allocations += 1;
+        }
+    }
+
+    // Copy a finished path into a caller's buffer, counting it if it grows
+    static void copy(const std::vector<int>& from, std::vector<int>& to) {
+        if (to.capacity() < from.size()) {
+            pathStats.allocations += 1;
+        }
+        to.assign(from.begin(), from.end());
+    }
+};
+
+// Each thread searches with its own workspace so queries never contend
+thread_local SearchWorkspace searchWorkspace;
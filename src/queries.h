@@ -0,0 +1,112 @@
+#pragma once
+
+#include <flecs.h>
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+
+#include "components.h"
+
+/**** Stats ****/
+
+// How a walk finds its tables. Cached walks use the queries below. AdHoc
+// walks build a filter with the same terms for every walk, the way the code
+// did before the queries were cached, so the two can be compared.
+enum class QueryMode {
+    Cached,
+    AdHoc,
+};
+
+// Query setup against iteration, per mode. Cached queries match each table
+// once, when flecs creates it, so `built` and `buildMs` stay flat after
+// startup. An ad-hoc walk pays for building its filter every time, and the
+// filter matches tables while it iterates, which lands in `walkMs`.
+struct QueryStats {
+    uint64_t built   = 0;  // queries constructed
+    uint64_t tables  = 0;  // matched tables iterated
+    double   buildMs = 0;  // spent building queries during walks
+    double   walkMs  = 0;  // spent iterating, ad-hoc matching included
+};
+
+std::array<QueryStats, 2> queryStats;
+
+QueryStats& statsFor(QueryMode mode) {
+    return queryStats[static_cast<size_t>(mode)];
+}
+
+/**** Queries ****/
+
+// Queries walked every frame or tick, built once at startup. A cached query
+// keeps its list of matching tables up to date as tables are created, so a
+// walk visits only those instead of matching every table in the world the
+// way `ecs.each` does on each call. Walk them through the walk* functions,
+// which count the work and honour `mode`.
+struct Queries {
+    flecs::world_t*                           world;
+    QueryMode                                 mode = QueryMode::Cached;
+    flecs::query<const Position>              workers;
+    flecs::query<const Position>              trees;
+    flecs::query<const Count, const Position> wood;
+
+    explicit Queries(flecs::world& ecs)
+        : world(ecs.c_ptr())
+        , workers(ecs.query_builder<const Position>().with<WorkerTag>().build())
+        , trees(ecs.query_builder<const Position>().with<TreeTag>().build())
+        , wood(ecs.query_builder<const Count, const Position>()
+                   .with<WoodTag>()
+                   .build()) {
+        statsFor(QueryMode::Cached).built += 3;
+    }
+
+    // `fn(flecs::iter&, const Position*)` per worker table
+    template <typename Fn>
+    void walkWorkers(Fn&& fn) const {
+        walk(workers, [](auto& b) { b.template with<WorkerTag>(); }, fn);
+    }
+
+    // `fn(flecs::iter&, const Position*)` per tree table
+    template <typename Fn>
+    void walkTrees(Fn&& fn) const {
+        walk(trees, [](auto& b) { b.template with<TreeTag>(); }, fn);
+    }
+
+    // `fn(flecs::iter&, const Count*, const Position*)` per wood pile table
+    template <typename Fn>
+    void walkWood(Fn&& fn) const {
+        walk(wood, [](auto& b) { b.template with<WoodTag>(); }, fn);
+    }
+
+   private:
+    // `terms` adds whatever the query has beyond its components, so an
+    // ad-hoc filter matches the same tables
+    template <typename... Comps, typename Terms, typename Fn>
+    void walk(
+        const flecs::query<Comps...>& query, Terms&& terms, Fn& fn
+    ) const {
+        using Clock       = std::chrono::steady_clock;
+        using Ms          = std::chrono::duration<double, std::milli>;
+        QueryStats& stats = statsFor(mode);
+        auto        visit = [&](flecs::iter& it, Comps*... columns) {
+            stats.tables += 1;
+            fn(it, columns...);
+        };
+        if (mode == QueryMode::Cached) {
+            const auto start = Clock::now();
+            query.iter(visit);
+            stats.walkMs += Ms(Clock::now() - start).count();
+            return;
+        }
+
+        const auto   start = Clock::now();
+        flecs::world ecs(world);
+        auto         builder = ecs.filter_builder<Comps...>();
+        terms(builder);
+        auto       filter = builder.build();
+        const auto built  = Clock::now();
+        filter.iter(visit);
+        stats.built += 1;
+        stats.buildMs += Ms(built - start).count();
+        stats.walkMs += Ms(Clock::now() - built).count();
+    }
+};
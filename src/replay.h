@@ -0,0 +1,134 @@
+#pragma once
+
+#include <flecs.h>
+#include <fmt/core.h>
+
+#include <cstdint>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "components.h"
+#include "queries.h"
+#include "utils/rng.h"
+
+/**** World hash ****/
+
+uint64_t positionHash(Position pos) {
+    return hashCombine(static_cast<uint32_t>(pos.v.x), pos.v.y);
+}
+
+uint64_t workerHash(flecs::entity e, Position pos) {
+    uint64_t h = hashCombine(positionHash(pos), e.has<CarryingWood>());
+    if (e.has<Idle>()) {
+        h = hashCombine(h, 1);
+    } else if (const MoveTo* moveTo = e.get<MoveTo>()) {
+        h = hashCombine(hashCombine(h, 2), positionHash(moveTo->target));
+    } else if (const ChopingTree* chopping = e.get<ChopingTree>()) {
+        h = hashCombine(hashCombine(h, 3), chopping->doneAt);
+    } else if (e.has<PathPending>()) {
+        h = hashCombine(h, 4);
+    }
+    return h;
+}
+
+// Summary of the simulation state after a tick: every worker's tile and
+// state, every tree and every wood pile. Entities are summed rather than
+// chained, so the hash doesn't depend on table order, and entity ids and
+// path tickets are left out since they follow the order work was done in.
+uint64_t worldHash(const flecs::world& ecs, const Queries& queries) {
+    uint64_t workers = 0;
+    uint64_t trees   = 0;
+    uint64_t wood    = 0;
+    queries.walkWorkers([&workers](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            workers += workerHash(it.entity(i), pos[i]);
+        }
+    });
+    queries.walkTrees([&trees](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            trees += positionHash(pos[i]);
+        }
+    });
+    queries.walkWood([&wood](flecs::iter& it, const Count* count,
+                             const Position* pos) {
+        for (auto i : it) {
+            wood += hashCombine(positionHash(pos[i]), count[i].v);
+        }
+    });
+
+    uint64_t h = hashCombine(0, ecs.get<Tick>()->v);
+    h          = hashCombine(h, workers);
+    h          = hashCombine(h, trees);
+    return hashCombine(h, wood);
+}
+
+/**** Replay log ****/
+
+// A recorded run: the inputs it was started with, by name, and the world
+// hash after each tick. Running the same inputs again and comparing hashes
+// finds the first tick where a change made the simulation behave
+// differently. Stored as text, one `name value` pair per line, then a line
+// `hashes` and one hash per tick in hex.
+struct ReplayLog {
+    using Inputs = std::vector<std::pair<std::string, int64_t>>;
+
+    Inputs                inputs;
+    std::vector<uint64_t> hashes;
+
+    std::optional<int64_t> input(std::string_view name) const {
+        for (const auto& [key, value] : inputs) {
+            if (key == name) {
+                return value;
+            }
+        }
+        return std::nullopt;
+    }
+};
+
+bool saveReplay(const std::string& path, const ReplayLog& log) {
+    std::ofstream out(path);
+    if (!out) {
+        fmt::println("[saveReplay] Cannot write {}", path);
+        return false;
+    }
+    for (const auto& [name, value] : log.inputs) {
+        out << name << ' ' << value << '\n';
+    }
+    out << "hashes\n";
+    for (uint64_t hash : log.hashes) {
+        out << fmt::format("{:016x}\n", hash);
+    }
+    return static_cast<bool>(out);
+}
+
+std::optional<ReplayLog> loadReplay(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        fmt::println("[loadReplay] Cannot read {}", path);
+        return std::nullopt;
+    }
+
+    ReplayLog   log;
+    std::string name;
+    while (in >> name && name != "hashes") {
+        int64_t value;
+        if (!(in >> value)) {
+            fmt::println("[loadReplay] Bad value for {} in {}", name, path);
+            return std::nullopt;
+        }
+        log.inputs.emplace_back(name, value);
+    }
+    uint64_t hash;
+    while (in >> std::hex >> hash) {
+        log.hashes.push_back(hash);
+    }
+    if (!in.eof()) {
+        fmt::println("[loadReplay] Bad hash in {}", path);
+        return std::nullopt;
+    }
+    return log;
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <flecs.h>
+
+#include <atomic>
+#include <vector>
+
+#include "components.h"
+
+// Which worker has claimed the tree on each tile, one word per tile since
+// trees never share a tile. Claims are compare-and-swaps, so workers on
+// different threads can race for the same tree and exactly one wins. A
+// worker holds its claim from the moment a path to the tree comes back. The
+// claim lapses once its worker is gone, and is dropped when the tree goes.
+class Reservations {
+   public:
+    Reservations() = default;
+
+    explicit Reservations(Vec2I dim)
+        : dim(dim)
+        , claims(dim.x * dim.y) {}
+
+    // Whether `worker` could claim `tile` right now
+    bool available(
+        const flecs::world& ecs, Position tile, flecs::entity_t worker
+    ) const {
+        const flecs::entity_t holder = at(tile).load(std::memory_order_acquire);
+        return holder == 0 || holder == worker || !ecs.is_alive(holder);
+    }
+
+    // Claim `tile` for `worker`; false if a live worker holds it already
+    bool claim(const flecs::world& ecs, Position tile, flecs::entity_t worker) {
+        std::atomic<flecs::entity_t>& slot = at(tile);
+        flecs::entity_t holder = slot.load(std::memory_order_acquire);
+        while (holder != worker) {
+            if (holder != 0 && ecs.is_alive(holder)) {
+                return false;
+            }
+            // Fails and reloads `holder` if another worker got there first
+            if (slot.compare_exchange_weak(
+                    holder, worker, std::memory_order_acq_rel,
+                    std::memory_order_acquire
+                )) {
+                break;
+            }
+        }
+        return true;
+    }
+
+    void release(Position tile) {
+        at(tile).store(0, std::memory_order_release);
+    }
+
+    // Drop `worker`'s claim on `tile`, leaving anyone else's in place
+    void release(Position tile, flecs::entity_t worker) {
+        flecs::entity_t holder = worker;
+        at(tile).compare_exchange_strong(
+            holder, 0, std::memory_order_acq_rel, std::memory_order_acquire
+        );
+    }
+
+   private:
+    Vec2I                                     dim = {0, 0};
+    std::vector<std::atomic<flecs::entity_t>> claims;
+
+    std::atomic<flecs::entity_t>& at(Position tile) {
+        return claims[tile.v.y * dim.x + tile.v.x];
+    }
+
+    const std::atomic<flecs::entity_t>& at(Position tile) const {
+        return claims[tile.v.y * dim.x + tile.v.x];
+    }
+};
+
+// Drop the claim on a tree's tile when the tree is destroyed
+void releaseOnRemove(flecs::world& ecs, Reservations& reservations) {
+    ecs.observer<const Position>()
+        .with<TreeTag>()
+        .event(flecs::OnRemove)
+        .each([&reservations](flecs::entity, const Position& pos) {
+            reservations.release(pos);
+        });
+}
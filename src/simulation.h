@@ -0,0 +1,221 @@
+#pragma once
+
+#include <flecs.h>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#include "components.h"
+#include "gather_wood_behavior.h"
+#include "metrics.h"
+#include "path_service.h"
+#include "pathfinder.h"
+#include "queries.h"
+#include "reservations.h"
+#include "spatial_index.h"
+#include "tilemap.h"
+#include "trees.h"
+#include "utils/log.h"
+#include "utils/profiler.h"
+#include "utils/rng.h"
+#include "utils/timer_wheel.h"
+#include "utils/util.h"
+#include "workers.h"
+
+int hardwareThreads() {
+    return std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+}
+
+// A* by default: on open maps like the simulation's, JPS expands about half
+// as many nodes but its tile-by-tile jumps make it slower in wall time
+Pathfinder pathfinderFromTilemap(
+    const Tilemap& map, PathBackend backend = PathBackend::AStar
+) {
+    Pathfinder pathfinder{.map = map.layer(Tilemap::Grass), .backend = backend};
+
+    std::vector<uint8_t> terrain(map.size());
+    for (int i = 0; i < map.size(); ++i) {
+        const uint8_t weight = Tilemap::TERRAIN[map.get(map.pos(i))];
+        terrain[i]           = weight ? weight : TERRAIN_UNIT;
+    }
+    pathfinder.setTerrain(std::move(terrain));
+    pathfinder.buildRegions();
+    if (map.size() >= HPA_MIN_TILES) {
+        pathfinder.buildHierarchy(HPA_CLUSTER_SIZE);
+    }
+    return pathfinder;
+}
+
+// Bookkeeping at the start of each simulation tick, before the gather wood
+// systems run. In lockstep the path queries from the last tick are waited
+// for rather than picked up whenever they finish.
+void simulationUpdate(
+    flecs::world&       ecs,
+    const Queries&      queries,
+    Pathfinder&         pathfinder,
+    const SpatialIndex& trees,
+    PathService&        pathService,
+    Reservations&       reservations,
+    BitGrid&            openTrees,
+    bool                lockstep
+) {
+    Tick* tick = ecs.get_mut<Tick>();
+    tick->v += 1;
+    PROFILE_BEGIN_TICK(tick->v);
+    PROFILE_FUNCTION();
+    LOG(Info, Sim, "\n[simulationUpdate] tick: {}", tick->v);
+
+    if (lockstep) {
+        pathService.settle();
+    }
+
+    // Workers solve against a copy, so hand them a new one after map edits
+    if (pathService.snapshotRevision() != pathfinder.revision) {
+        pathService.setSnapshot(pathfinder);
+    }
+    applyPathResults(ecs, pathfinder, trees, pathService, reservations);
+    // After the claims above, so idle workers skip the trees just taken
+    collectOpenTrees(ecs, queries, reservations, openTrees);
+    pathService.setGoals(openTrees);
+    PathServiceStats queueStats = pathService.stats();
+    LOG(
+        Info, Path,
+        "[simulationUpdate] paths: queued {} resolved {} latency mean {:.2f}ms "
+        "max {:.2f}ms",
+        queueStats.queueDepth, queueStats.drained, queueStats.meanLatencyMs,
+        queueStats.maxLatencyMs
+    );
+
+    const QueryStats& walks = statsFor(queries.mode);
+    LOG(
+        Info, Sim,
+        "[simulationUpdate] queries: built {} tables walked {}", walks.built,
+        walks.tables
+    );
+
+    // Only walk the piles if the listing will be logged
+    if constexpr (logEnabled(LogLevel::Debug, LogCategory::Wood)) {
+        queries.walkWood([](flecs::iter& it, const Count* count,
+                            const Position* pos) {
+            for (auto i : it) {
+                LOG(Debug, Wood, "Wood at {}, count: {}", pos[i].v, count[i].v);
+            }
+        });
+    }
+}
+
+// Independent random streams split off the simulation seed. Anything that
+// draws during a tick on several threads splits again by entity and tick,
+// never by thread, so the numbers don't depend on how work was scheduled.
+enum class RngStream : uint64_t {
+    WorkerSpawn = 1,
+    TreeSpawn,
+    MapEdits,
+};
+
+struct SimulationOptions {
+    int      workers     = 3;
+    int      trees       = 10;
+    // Systems run on `threads`; path queries get one fewer, but at least one
+    int      threads     = hardwareThreads();
+    float    tickSeconds = 0.2f;
+    uint64_t seed        = 1;
+    // Same seed, same world on every tick regardless of thread count, at the
+    // cost of waiting for path queries each tick
+    bool lockstep = false;
+    // Publish SimMetrics for the explorer (see metrics.h)
+    bool metrics = false;
+};
+
+// One running game: the world, its map and the services its systems share,
+// wired together. Systems and observers keep references into it, so it stays
+// where it was built. The window and the headless driver both run it by
+// calling ecs.progress().
+struct Simulation {
+    Tilemap                     map;
+    Pathfinder                  pathfinder;
+    PathService                 pathService;
+    WoodPiles                   woodPiles;
+    SpatialIndex                treeIndex;
+    Reservations                reservations;
+    BitGrid                     openTrees;  // see collectOpenTrees
+    TimerWheel<flecs::entity_t> workerTimers;
+    Rng                         rng;
+    bool                        lockstep;
+    // Declared after everything its systems and observers capture, so it is
+    // destroyed first and the observers it fires on the way out still find
+    // those members alive
+    flecs::world  ecs;
+    Queries       queries;
+    flecs::entity tick;  // fires once per simulation tick
+
+    Simulation(Tilemap tiles, const SimulationOptions& options)
+        : map(std::move(tiles))
+        , pathfinder(pathfinderFromTilemap(map))
+        , pathService(std::max(1, options.threads - 1))
+        , woodPiles(map.dim)
+        , reservations(map.dim)
+        , openTrees(map.dim)
+        , rng(options.seed)
+        , lockstep(options.lockstep)
+        , queries(ecs) {
+        // Keep the pathfinder in sync with map edits; moving workers repair
+        // their paths instead of searching again
+        pathfinder.incremental = true;
+        map.onChange([this](Position pos, Tilemap::TileType type) {
+            pathfinder.setTile(pos, Tilemap::TERRAIN[type]);
+        });
+
+        registerComponents(ecs);
+        indexTagged<TreeTag>(ecs, treeIndex);
+        releaseOnRemove(ecs, reservations);
+        Rng workerRng = stream(RngStream::WorkerSpawn);
+        Rng treeRng   = stream(RngStream::TreeSpawn);
+        spawnWorkers(ecs, options.workers, map, workerRng);
+        spawnTrees(ecs, options.trees, map, treeRng);
+
+        // The simulation runs from ecs.progress() at a fixed tick, spread
+        // over `options.threads`
+        ecs.set_threads(options.threads);
+        tick = ecs.timer().interval(options.tickSeconds);
+        ecs.system("SimulationUpdate")
+            .kind(flecs::OnLoad)
+            .tick_source(tick)
+            .immediate()
+            .iter([this](flecs::iter&) {
+#ifndef HEADLESS
+                // Only clear the debug drawer every simulation tick since
+                // it will only be written to during the simulation update
+                // and otherwise it will be cleared every frame
+                debugDrawer.clear(SIM_DEBUG_LAYER);
+#endif
+                simulationUpdate(
+                    ecs, queries, pathfinder, treeIndex, pathService,
+                    reservations, openTrees, lockstep
+                );
+            });
+        registerGatherWoodSystems(
+            ecs, tick, map, treeIndex, reservations, woodPiles, workerTimers,
+            pathfinder, pathService
+        );
+        if (options.metrics) {
+            registerMetrics(ecs, tick, woodPiles);
+        }
+#ifdef PROFILER
+        // Registered last, so the tick span covers every system above
+        ecs.system("EndTick")
+            .kind(flecs::PostUpdate)
+            .tick_source(tick)
+            .iter([](flecs::iter&) { PROFILE_END_TICK(); });
+#endif
+    }
+
+    Rng stream(RngStream id, uint64_t key = 0) const {
+        return rng.split(static_cast<uint64_t>(id)).split(key);
+    }
+
+    Simulation(const Simulation&)            = delete;
+    Simulation& operator=(const Simulation&) = delete;
+};
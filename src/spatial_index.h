@@ -0,0 +1,197 @@
+#pragma once
+
+#include <flecs.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "components.h"
+#include "pathing/grid.h"
+
+// Uniform-grid spatial hash over tile positions. Entities are bucketed by
+// the CELL_SIZE x CELL_SIZE block they sit in, and only occupied blocks are
+// stored, so lookups near a position never touch entities far from it.
+// Distances are octile, i.e. walking cost on open ground.
+class SpatialIndex {
+   public:
+    static constexpr int CELL_SIZE = 8;
+
+    struct Entry {
+        flecs::entity_t id;
+        Position        pos;
+        int             dist = 0;  // from the query position, in path cost
+    };
+
+    void insert(flecs::entity_t id, Position pos) {
+        if (auto it = where.find(id); it != where.end()) {
+            if (it->second == pos) {
+                return;
+            }
+            remove(id);
+        }
+        const Vec2I c = cellOf(pos);
+        cells[key(c)].push_back({id, pos});
+        where.emplace(id, pos);
+        if (where.size() == 1) {
+            minCell = maxCell = c;
+        } else {
+            minCell = {std::min(minCell.x, c.x), std::min(minCell.y, c.y)};
+            maxCell = {std::max(maxCell.x, c.x), std::max(maxCell.y, c.y)};
+        }
+    }
+
+    void remove(flecs::entity_t id) {
+        auto it = where.find(id);
+        if (it == where.end()) {
+            return;
+        }
+        auto cell = cells.find(key(cellOf(it->second)));
+        std::erase_if(cell->second, [id](const Entry& e) {
+            return e.id == id;
+        });
+        if (cell->second.empty()) {
+            cells.erase(cell);
+        }
+        where.erase(it);
+    }
+
+    size_t size() const {
+        return where.size();
+    }
+
+    // Every entry within `radius` tiles of walking distance of `center`
+    template <typename Fn>
+    void forEachInRadius(Position center, int radius, Fn&& fn) const {
+        const Vec2I lo = cellOf(Position(center.v - Vec2I(radius, radius)));
+        const Vec2I hi = cellOf(Position(center.v + Vec2I(radius, radius)));
+        for (int cy = lo.y; cy <= hi.y; ++cy) {
+            for (int cx = lo.x; cx <= hi.x; ++cx) {
+                auto cell = cells.find(key({cx, cy}));
+                if (cell == cells.end()) {
+                    continue;
+                }
+                for (Entry e : cell->second) {
+                    e.dist = octile(center.v, e.pos.v);
+                    if (e.dist <= radius * STRAIGHT_COST) {
+                        fn(e);
+                    }
+                }
+            }
+        }
+    }
+
+    // Up to `k` entries closest to `center` for which `accept(Entry)` holds,
+    // nearest first, ties by id. Searches rings of cells outward and stops
+    // once no unvisited cell can hold anything closer than the k-th best.
+    // Once a ring has more cells than are occupied at all, the occupied
+    // cells not yet visited are checked directly, so sparse entries far
+    // apart don't cost a walk over every empty cell between them.
+    template <typename Pred>
+    void nearest(
+        Position center, size_t k, Pred&& accept, std::vector<Entry>& out
+    ) const {
+        out.clear();
+        if (where.empty() || k == 0) {
+            return;
+        }
+        const Vec2I c        = cellOf(center);
+        const int   lastRing = std::max(
+            {c.x - minCell.x, maxCell.x - c.x, c.y - minCell.y, maxCell.y - c.y}
+        );
+
+        auto closer = [](const Entry& a, const Entry& b) {
+            return a.dist < b.dist || (a.dist == b.dist && a.id < b.id);
+        };
+        auto visitEntries = [&](const std::vector<Entry>& entries) {
+            for (Entry e : entries) {
+                e.dist = octile(center.v, e.pos.v);
+                if (out.size() == k && !closer(e, out.back())) {
+                    continue;
+                }
+                if (!accept(e)) {
+                    continue;
+                }
+                auto at = std::upper_bound(out.begin(), out.end(), e, closer);
+                out.insert(at, e);
+                if (out.size() > k) {
+                    out.pop_back();
+                }
+            }
+        };
+        auto visit = [&](Vec2I cellPos) {
+            auto cell = cells.find(key(cellPos));
+            if (cell != cells.end()) {
+                visitEntries(cell->second);
+            }
+        };
+
+        for (int ring = 0; ring <= lastRing; ++ring) {
+            if (8 * ring > static_cast<int>(cells.size())) {
+                for (const auto& [cellKey, entries] : cells) {
+                    const Vec2I p = cellOf(entries.front().pos);
+                    if (std::max(std::abs(p.x - c.x), std::abs(p.y - c.y)) >=
+                        ring) {
+                        visitEntries(entries);
+                    }
+                }
+                return;
+            }
+            for (int dx = -ring; dx <= ring; ++dx) {
+                visit({c.x + dx, c.y - ring});
+                if (ring > 0) {
+                    visit({c.x + dx, c.y + ring});
+                }
+            }
+            for (int dy = -ring + 1; dy <= ring - 1; ++dy) {
+                visit({c.x - ring, c.y + dy});
+                visit({c.x + ring, c.y + dy});
+            }
+            // Anything in the next ring is at least this far away
+            const int bound = (ring * CELL_SIZE + 1) * STRAIGHT_COST;
+            if (out.size() == k && out.back().dist < bound) {
+                return;
+            }
+        }
+    }
+
+   private:
+    std::unordered_map<uint64_t, std::vector<Entry>> cells;
+    std::unordered_map<flecs::entity_t, Position>    where;
+    // Bounds of the cells ever used; rings past them can't hold anything
+    Vec2I minCell = {0, 0};
+    Vec2I maxCell = {0, 0};
+
+    static Vec2I cellOf(Position pos) {
+        // Round toward negative infinity so cells never straddle zero
+        auto floorDiv = [](int a) {
+            return a >= 0 ? a / CELL_SIZE : -((-a + CELL_SIZE - 1) / CELL_SIZE);
+        };
+        return {floorDiv(pos.v.x), floorDiv(pos.v.y)};
+    }
+
+    static uint64_t key(Vec2I cell) {
+        return (uint64_t(uint32_t(cell.x)) << 32) | uint32_t(cell.y);
+    }
+};
+
+// Keep `index` in sync with every entity that has both a Position and `Tag`.
+// Entries go in when the Position is set, so spawn code adds the tag first.
+template <typename Tag>
+void indexTagged(flecs::world& ecs, SpatialIndex& index) {
+    ecs.observer<const Position>()
+        .with<Tag>()
+        .event(flecs::OnSet)
+        .each([&index](flecs::entity e, const Position& pos) {
+            index.insert(e.id(), pos);
+        });
+    ecs.observer<const Position>()
+        .with<Tag>()
+        .event(flecs::OnRemove)
+        .each([&index](flecs::entity e, const Position&) {
+            index.remove(e.id());
+        });
+}
@@ -1,9 +1,19 @@
 #pragma once
 
+#ifndef HEADLESS
 #include <SFML/Graphics.hpp>
+#endif
+#include <array>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
 #include <vector>
 
 #include "components.h"
+#include "pathing/bit_grid.h"
+#include "pathing/grid.h"
+#include "utils/profiler.h"
+#include "utils/rng.h"
 #include "utils/util.h"
 
 struct Tilemap {
@@ -11,19 +21,43 @@ struct Tilemap {
         Water,
         Grass,
     };
+    static constexpr int TILE_TYPES = 2;
+    // Cost of entering each type in TERRAIN_UNITs; 0 means it can't be walked
+    static constexpr std::array<uint8_t, TILE_TYPES> TERRAIN = {
+        0,             // Water
+        TERRAIN_UNIT,  // Grass
+    };
+    // Called with the tile and its new type whenever `set` changes a tile
+    using Listener = std::function<void(Position, TileType)>;
+
     static inline int     renderDim = 100;
     Vec2I                 dim;
-    std::vector<TileType> tiles;
+    std::vector<Listener> listeners;
+    // One bit per tile for each type and nothing else per tile; a tile's
+    // type is whichever layer has its bit set
+    std::array<BitGrid, TILE_TYPES> layers;
+
+    // `tiles` row-major, only read to fill the layers
+    Tilemap(Vec2I dim, const std::vector<TileType>& tiles) : dim(dim) {
+        for (BitGrid& layer : layers) {
+            layer = BitGrid(dim);
+        }
+        for (int i = 0; i < static_cast<int>(tiles.size()); ++i) {
+            layers[tiles[i]].set({i % dim.x, i / dim.x}, true);
+        }
+    }
 
+#ifndef HEADLESS
     void render(sf::RenderTarget& window) {
-        for (int i = 0; i < tiles.size(); i++) {
+        PROFILE_SCOPE("Tilemap::render");
+        for (int i = 0; i < size(); i++) {
             const int x = i % dim.x;
             const int y = i / dim.x;
 
             sf::RectangleShape tile;
             tile.setSize({(float)renderDim, (float)renderDim});
             tile.setPosition(x * renderDim, y * renderDim);
-            switch (tiles[i]) {
+            switch (get(pos(i))) {
                 case Grass:
                     tile.setFillColor(sf::Color::Green);
                     break;
@@ -36,13 +70,48 @@ struct Tilemap {
             window.draw(tile);
         }
     }
+#endif
+
+    const BitGrid& layer(TileType type) const {
+        return layers[type];
+    }
+
+    int size() const {
+        return dim.x * dim.y;
+    }
+
+    Position pos(int i) const {
+        return Position(Vec2I(i % dim.x, i / dim.x));
+    }
 
     TileType operator[](const Position pos) const {
         return get(pos);
     }
 
     TileType get(Position pos) const {
-        return tiles[pos.v.y * dim.x + pos.v.x];
+        for (int type = 0; type < TILE_TYPES - 1; ++type) {
+            if (layers[type].get(pos.v)) {
+                return static_cast<TileType>(type);
+            }
+        }
+        return static_cast<TileType>(TILE_TYPES - 1);
+    }
+
+    // Change a tile and notify listeners, e.g. so paths can be repaired
+    void set(Position pos, TileType type) {
+        const TileType tile = get(pos);
+        if (tile == type) {
+            return;
+        }
+        layers[tile].set(pos.v, false);
+        layers[type].set(pos.v, true);
+        for (const Listener& listener : listeners) {
+            listener(pos, type);
+        }
+    }
+
+    void onChange(Listener listener) {
+        listeners.push_back(std::move(listener));
     }
 
     Vec2I worldToTile(Vec2 pos) const {
@@ -65,16 +134,36 @@ struct Tilemap {
     }
 };
 
-Position randomTile(Tilemap::TileType type, const Tilemap& map) {
-    auto     dist_w = std::uniform_int_distribution<int>(0, map.dim.x);
-    auto     dist_h = std::uniform_int_distribution<int>(0, map.dim.y);
-    Position pos;
-    for (int i = 0; i < 1000; ++i) {
-        pos = Position(Vec2I(dist_w(gen), dist_h(gen)));
-        if (map[pos] == type) {
-            return pos;
-        }
+// Uniform over the tiles of `type`, picked by rank straight from its layer;
+// only fails if there are none
+Position randomTile(Tilemap::TileType type, const Tilemap& map, Rng& rng) {
+    const BitGrid& layer = map.layer(type);
+    const int      total = layer.count();
+    if (total == 0) {
+        std::cerr << "Failed to find a tile of type " << type << std::endl;
+        throw std::runtime_error("Failed to find a tile of type");
     }
-    std::cerr << "Failed to find a tile of type " << type << std::endl;
-    throw std::runtime_error("Failed to find a tile of type");
-}
\ No newline at end of file
+    return Position(layer.nth(static_cast<int>(rng.below(total))));
+}
+
+// `count` distinct tiles of `type`, or all of them if there are fewer. One
+// pass of selection sampling over the layer's set bits, so every subset is
+// equally likely and nothing is ever drawn twice.
+std::vector<Position> randomTiles(
+    Tilemap::TileType type, size_t count, const Tilemap& map, Rng& rng
+) {
+    const BitGrid&        layer = map.layer(type);
+    const size_t          total = layer.count();
+    std::vector<Position> result;
+    result.reserve(std::min(count, total));
+
+    size_t seen = 0;
+    layer.forEach([&](Vec2I tile) {
+        const size_t needed = count - result.size();
+        const size_t left   = total - seen++;
+        if (needed > 0 && rng.unit() * left < needed) {
+            result.push_back(Position(tile));
+        }
+    });
+    return result;
+}
@@ -4,37 +4,66 @@
 #include <fmt/core.h>
 
 #include <iostream>
+#include <vector>
 
 #include "components.h"
+#include "queries.h"
 #include "tilemap.h"
+#include "utils/log.h"
+#include "utils/profiler.h"
 
-void spawnWood(flecs::world& ecs, const Position& pos) {
-    fmt::println("Spawning wood at {}", pos);
-    bool found;
-    ecs.each([&pos, &found](
-                 flecs::entity e, Count& count, WoodTag, const Position& p
-             ) {
-        if (p == pos) {
-            fmt::println("Incrementing wood count at {}, {}", pos.v, count.v);
-            count.v += 1;
-            found = true;
-            return;
-        }
-    });
-    if (found) return;
-    ecs.entity().add<WoodTag>().set<Position>(pos).set<Count>(Count(1));
+// Wood piles by tile, kept alongside the WoodTag entities so a deposit finds
+// its pile without scanning them
+struct WoodPiles {
+    Vec2I                        dim = {0, 0};
+    std::vector<flecs::entity_t> pileAt;  // 0 where the tile has no pile
+    std::vector<int>             counts;
+    std::vector<int>             tiles;  // tiles that have a pile
+    uint64_t                     deposited = 0;  // wood ever dropped off
+
+    WoodPiles() = default;
+
+    explicit WoodPiles(Vec2I dim)
+        : dim(dim)
+        , pileAt(dim.x * dim.y, 0)
+        , counts(dim.x * dim.y, 0) {}
+
+    int index(Position pos) const {
+        return pos.v.y * dim.x + pos.v.x;
+    }
+};
+
+void spawnWood(flecs::world& ecs, WoodPiles& piles, const Position& pos) {
+    LOG(Debug, Wood, "Spawning wood at {}", pos);
+    const int i = piles.index(pos);
+    piles.counts[i] += 1;
+    piles.deposited += 1;
+    if (piles.pileAt[i] != 0) {
+        LOG(
+            Debug, Wood, "Incrementing wood count at {}, {}", pos.v,
+            piles.counts[i]
+        );
+        ecs.entity(piles.pileAt[i]).set<Count>(Count(piles.counts[i]));
+        return;
+    }
+    piles.pileAt[i] =
+        ecs.entity().add<WoodTag>().set<Position>(pos).set<Count>(Count(1));
+    piles.tiles.push_back(i);
 }
 
-void renderWood(flecs::world& ecs, const Tilemap& map) {
-    ecs.each([&map](WoodTag, const Count& count, const Position& pos) {
-        // fmt::println("Rendering wood at {}, {}", pos.v, count.v);
-        auto worldPos = map.tileToWorld(pos);
-        if (count.v > 1) {
+#ifndef HEADLESS
+void renderWood(const WoodPiles& piles, const Tilemap& map) {
+    PROFILE_FUNCTION();
+    for (int i : piles.tiles) {
+        const Position pos      = map.pos(i);
+        const int      count    = piles.counts[i];
+        auto           worldPos = map.tileToWorld(pos);
+        if (count > 1) {
             textDrawer.draw(
                 {.pos   = worldPos - Vec2(20, 10),
                  .size  = 20,
                  .color = sf::Color(150, 105, 25)},
-                count.v, "W"
+                count, "W"
             );
         } else {
             textDrawer.draw(
@@ -44,30 +73,30 @@ void renderWood(flecs::world& ecs, const Tilemap& map) {
                 "W"
             );
         }
-    });
+    }
 }
+#endif
 
-void spawnTrees(flecs::world& ecs, int count, const Tilemap& map) {
-    auto dist_w = std::uniform_int_distribution<int>(0, map.dim.x - 1);
-    auto dist_h = std::uniform_int_distribution<int>(0, map.dim.y - 1);
-
-    for (int i = 0; i < count; i++) {
-        Position pos;
-        do {
-            pos = Position(Vec2I(dist_w(gen), dist_h(gen)));
-        } while (map[pos] != Tilemap::Grass);
+// Trees go on distinct grass tiles; fewer are spawned if there is no room
+void spawnTrees(flecs::world& ecs, int count, const Tilemap& map, Rng& rng) {
+    for (Position pos : randomTiles(Tilemap::Grass, count, map, rng)) {
         ecs.entity().add<TreeTag>().set<Position>(pos);
     }
 }
 
-void renderTrees(flecs::world& ecs, const Tilemap& map) {
-    ecs.each([&map](TreeTag, const Position& pos) {
-        auto worldPos = map.tileToWorld(pos);
-        textDrawer.draw(
-            {.pos   = worldPos - Vec2(20, 10),
-             .size  = 20,
-             .color = sf::Color(150, 105, 25)},
-            "T"
-        );
+#ifndef HEADLESS
+void renderTrees(const Queries& queries, const Tilemap& map) {
+    PROFILE_FUNCTION();
+    queries.walkTrees([&map](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            auto worldPos = map.tileToWorld(pos[i]);
+            textDrawer.draw(
+                {.pos   = worldPos - Vec2(20, 10),
+                 .size  = 20,
+                 .color = sf::Color(150, 105, 25)},
+                "T"
+            );
+        }
     });
-}
\ No newline at end of file
+}
+#endif
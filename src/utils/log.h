@@ -0,0 +1,225 @@
+#pragma once
+
+#include <fmt/format.h>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <new>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// Logging in two halves. Which calls exist is decided at compile time: a
+// call below LOG_LEVEL or outside LOG_CATEGORIES is discarded by `if
+// constexpr`, arguments and all. The calls that remain copy their arguments
+// into a lock-free ring buffer, and a background thread does the formatting
+// and the writing, so a hot loop pays for a copy and an atomic increment.
+//
+//   LOG(Debug, Workers, "[handleIdle] Worker {} is idle", e.id());
+//
+// Build with -DLOG_LEVEL=0 to keep everything, or with e.g.
+// -DLOG_CATEGORIES=LOG_SIM|LOG_PATH to keep only some categories.
+
+/**** Compile-time filter ****/
+
+enum class LogLevel { Trace, Debug, Info, Warn, Error };
+
+#define LOG_SIM     (1u << 0)
+#define LOG_WORKERS (1u << 1)
+#define LOG_WOOD    (1u << 2)
+#define LOG_PATH    (1u << 3)
+#define LOG_HTN     (1u << 4)
+
+enum class LogCategory : uint32_t {
+    Sim     = LOG_SIM,
+    Workers = LOG_WORKERS,
+    Wood    = LOG_WOOD,
+    Path    = LOG_PATH,
+    Htn     = LOG_HTN,
+};
+
+#ifndef LOG_LEVEL
+#define LOG_LEVEL 2  // Info
+#endif
+#ifndef LOG_CATEGORIES
+#define LOG_CATEGORIES 0xffffffffu
+#endif
+
+constexpr bool logEnabled(LogLevel level, LogCategory category) {
+    return static_cast<int>(level) >= LOG_LEVEL &&
+           (static_cast<uint32_t>(category) & (LOG_CATEGORIES)) != 0;
+}
+
+/**** Logger ****/
+
+class Logger {
+   public:
+    // Records in flight before new ones are dropped, and the room each has
+    // for its arguments. Larger arguments fail to compile; format them to a
+    // string first.
+    static constexpr size_t CAPACITY  = 1 << 13;
+    static constexpr size_t ARG_BYTES = 96;
+
+    Logger() {
+        for (size_t i = 0; i < CAPACITY; ++i) {
+            records[i].sequence.store(i, std::memory_order_relaxed);
+        }
+        thread = std::thread([this] { run(); });
+    }
+
+    ~Logger() {
+        stopping.store(true, std::memory_order_release);
+        thread.join();
+    }
+
+    Logger(const Logger&)            = delete;
+    Logger& operator=(const Logger&) = delete;
+
+    // Safe from any thread. Never blocks; drops the message if the buffer
+    // is full.
+    template <typename... Args>
+    void push(fmt::format_string<Args...> format, Args&&... args) {
+        using Stored = std::tuple<std::decay_t<Args>...>;
+        static_assert(
+            sizeof(Stored) <= ARG_BYTES &&
+                alignof(Stored) <= alignof(std::max_align_t),
+            "log arguments too large; format them first"
+        );
+
+        Record* record = claim();
+        if (!record) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        new (record->args) Stored(std::forward<Args>(args)...);
+        const fmt::string_view view = format;
+        record->format  = std::string_view(view.data(), view.size());
+        record->consume = [](std::byte* bytes, std::string_view format,
+                             fmt::memory_buffer& out) {
+            Stored& stored = *std::launder(reinterpret_cast<Stored*>(bytes));
+            std::apply(
+                [&](const auto&... values) {
+                    fmt::format_to(
+                        std::back_inserter(out), fmt::runtime(format),
+                        values...
+                    );
+                },
+                stored
+            );
+            out.push_back('\n');
+            stored.~Stored();
+        };
+        record->sequence.store(
+            record->position + 1, std::memory_order_release
+        );
+    }
+
+    // Wait until everything pushed so far has been written
+    void flush() {
+        const size_t target = head.load(std::memory_order_acquire);
+        while (written.load(std::memory_order_acquire) < target) {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+    }
+
+   private:
+    struct Record {
+        // Equals the record's position when free, position + 1 once written
+        std::atomic<size_t> sequence;
+        size_t              position;
+        std::string_view    format;
+        // Formats the arguments into `out` and destroys them
+        void (*consume)(std::byte*, std::string_view, fmt::memory_buffer&);
+        alignas(std::max_align_t) std::byte args[ARG_BYTES];
+    };
+
+    std::array<Record, CAPACITY> records;
+    std::atomic<size_t>          head     = 0;  // next position to claim
+    std::atomic<size_t>          written  = 0;  // positions written out
+    std::atomic<uint64_t>        dropped  = 0;
+    std::atomic<bool>            stopping = false;
+    std::thread                  thread;
+
+    // Bounded multi-producer queue: producers race for `head` and each owns
+    // the record it won until it bumps the record's sequence
+    Record* claim() {
+        size_t position = head.load(std::memory_order_relaxed);
+        while (true) {
+            Record&      record = records[position % CAPACITY];
+            const size_t seq = record.sequence.load(std::memory_order_acquire);
+            const auto   diff = static_cast<intptr_t>(seq - position);
+            if (diff == 0) {
+                if (head.compare_exchange_weak(
+                        position, position + 1, std::memory_order_relaxed
+                    )) {
+                    record.position = position;
+                    return &record;
+                }
+            } else if (diff < 0) {
+                return nullptr;  // full
+            } else {
+                position = head.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    void run() {
+        fmt::memory_buffer out;
+        size_t             tail     = 0;
+        uint64_t           reported = 0;
+        while (true) {
+            const bool stop = stopping.load(std::memory_order_acquire);
+
+            const size_t start = tail;
+            while (true) {
+                Record& record = records[tail % CAPACITY];
+                if (record.sequence.load(std::memory_order_acquire) !=
+                    tail + 1) {
+                    break;
+                }
+                record.consume(record.args, record.format, out);
+                record.sequence.store(
+                    tail + CAPACITY, std::memory_order_release
+                );
+                tail += 1;
+            }
+            const uint64_t lost = dropped.load(std::memory_order_relaxed);
+            if (lost != reported) {
+                fmt::format_to(
+                    std::back_inserter(out), "[log] dropped {} messages\n",
+                    lost - reported
+                );
+                reported = lost;
+            }
+            if (out.size() > 0) {
+                std::fwrite(out.data(), 1, out.size(), stdout);
+                std::fflush(stdout);
+                out.clear();
+            }
+            written.store(tail, std::memory_order_release);
+
+            if (tail == start) {
+                if (stop) {
+                    return;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+    }
+};
+
+Logger logger;
+
+#define LOG(level, category, ...)                                             \
+    do {                                                                      \
+        if constexpr (logEnabled(LogLevel::level, LogCategory::category)) {   \
+            logger.push(__VA_ARGS__);                                         \
+        }                                                                     \
+    } while (0)
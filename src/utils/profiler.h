@@ -0,0 +1,323 @@
+#pragma once
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "util.h"
+
+// Scoped timers for finding where a tick goes. Build with PROFILER defined
+// and each PROFILE_SCOPE records a span on the calling thread: its duration
+// goes into a rolling histogram per name, and the span itself into a ring
+// that writeTrace() dumps as a Chrome trace (chrome://tracing or Perfetto),
+// one track per thread plus one for the simulation ticks. Without PROFILER
+// the macros expand to nothing and none of this is compiled.
+//
+//   void handleIdle(...) {
+//       PROFILE_FUNCTION();
+//       ...
+
+#ifdef PROFILER
+
+using ProfileTime = decltype(now());
+
+/**** Rolling histogram ****/
+
+// Durations over the last WINDOW samples, in buckets four to a power of two
+// so percentiles are within about 20%. Merging is adding the buckets.
+struct RollingHistogram {
+    static constexpr size_t WINDOW  = 1024;
+    static constexpr int    BUCKETS = 4 * 63;
+
+    std::array<uint32_t, BUCKETS> counts = {};
+    std::array<uint8_t, WINDOW>   recent = {};  // bucket of each sample
+    size_t                        next   = 0;
+    uint64_t                      total  = 0;  // samples ever added
+
+    static int bucketOf(uint64_t ns) {
+        if (ns < 4) {
+            return static_cast<int>(ns);
+        }
+        const int bits = static_cast<int>(std::bit_width(ns)) - 1;
+        const int sub  = static_cast<int>((ns >> (bits - 2)) & 3);
+        return 4 * (bits - 1) + sub;
+    }
+
+    // Smallest duration above every sample in `bucket`
+    static uint64_t upperBound(int bucket) {
+        if (bucket < 4) {
+            return bucket + 1;
+        }
+        const int bits = bucket / 4 + 1;
+        return uint64_t(5 + bucket % 4) << (bits - 2);
+    }
+
+    void add(uint64_t ns) {
+        if (total >= WINDOW) {
+            counts[recent[next]] -= 1;
+        }
+        const int bucket = bucketOf(ns);
+        counts[bucket] += 1;
+        recent[next] = static_cast<uint8_t>(bucket);
+        next         = (next + 1) % WINDOW;
+        total += 1;
+    }
+
+    void merge(const RollingHistogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+
+    uint64_t samples() const {
+        uint64_t n = 0;
+        for (uint32_t c : counts) {
+            n += c;
+        }
+        return n;
+    }
+
+    // Upper bound on the `p`th percentile, 0 < p <= 1
+    uint64_t percentile(double p) const {
+        const uint64_t n = samples();
+        if (n == 0) {
+            return 0;
+        }
+        const uint64_t rank = std::max<uint64_t>(1, uint64_t(p * n + 0.5));
+        uint64_t       seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts[i];
+            if (seen >= rank) {
+                return upperBound(i);
+            }
+        }
+        return upperBound(BUCKETS - 1);
+    }
+};
+
+/**** Profiler ****/
+
+class Profiler {
+   public:
+    // Spans kept per thread, and tick spans kept overall; the oldest go
+    // first
+    static constexpr size_t MAX_SPANS = 1 << 16;
+    static constexpr size_t MAX_TICKS = 1 << 12;
+
+    struct Span {
+        const char* name;
+        int64_t     startNs;  // since the profiler was created
+        int64_t     durationNs;
+        int         tick;
+    };
+
+    int64_t sinceStart(ProfileTime t) const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(t - epoch)
+            .count();
+    }
+
+    // `name` must outlive the profiler; string literals and __func__ do
+    void record(const char* name, ProfileTime start, ProfileTime end) {
+        static thread_local ThreadProfile* mine = registerThread();
+        const Span span{
+            .name       = name,
+            .startNs    = sinceStart(start),
+            .durationNs = sinceStart(end) - sinceStart(start),
+            .tick       = currentTick
+        };
+
+        // Only contended while a report or trace is being written
+        std::lock_guard lock(mine->mutex);
+        mine->histograms[name].add(static_cast<uint64_t>(span.durationNs));
+        push(mine->spans, mine->next, span, MAX_SPANS);
+    }
+
+    // Called on the main thread around each simulation tick
+    void beginTick(int tick) {
+        currentTick = tick;
+        tickStart   = now();
+    }
+
+    void endTick() {
+        const auto      end = now();
+        std::lock_guard lock(mutex);
+        push(
+            ticks, nextTick,
+            {.name       = "tick",
+             .startNs    = sinceStart(tickStart),
+             .durationNs = sinceStart(end) - sinceStart(tickStart),
+             .tick       = currentTick},
+            MAX_TICKS
+        );
+        tickHistogram.add(
+            static_cast<uint64_t>(sinceStart(end) - sinceStart(tickStart))
+        );
+    }
+
+    // Percentiles per name over each one's recent window, slowest first
+    void report() {
+        std::map<std::string, RollingHistogram> merged;
+        {
+            std::lock_guard lock(mutex);
+            merged["tick"] = tickHistogram;
+            for (const auto& thread : threads) {
+                std::lock_guard threadLock(thread->mutex);
+                for (const auto& [name, histogram] : thread->histograms) {
+                    merged[name].merge(histogram);
+                }
+            }
+        }
+
+        std::vector<std::pair<std::string, RollingHistogram>> rows(
+            merged.begin(), merged.end()
+        );
+        std::sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) {
+            return a.second.percentile(0.99) > b.second.percentile(0.99);
+        });
+        fmt::println(
+            "{:<24} {:>10} {:>10} {:>10} {:>10}", "scope", "calls", "p50 us",
+            "p90 us", "p99 us"
+        );
+        for (const auto& [name, h] : rows) {
+            fmt::println(
+                "{:<24} {:>10} {:>10.1f} {:>10.1f} {:>10.1f}", name, h.total,
+                h.percentile(0.5) / 1000.0, h.percentile(0.9) / 1000.0,
+                h.percentile(0.99) / 1000.0
+            );
+        }
+    }
+
+    // Chrome trace_event JSON of the spans still in the rings
+    bool writeTrace(const std::string& path) {
+        std::FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            fmt::println("[writeTrace] Cannot write {}", path);
+            return false;
+        }
+
+        bool first = true;
+        auto event = [&](const Span& span, int tid) {
+            fmt::print(
+                file,
+                "{}\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                "\"ts\":{:.3f},\"dur\":{:.3f},\"args\":{{\"tick\":{}}}}}",
+                first ? "" : ",", span.name, tid, span.startNs / 1000.0,
+                span.durationNs / 1000.0, span.tick
+            );
+            first = false;
+        };
+        auto threadName = [&](int tid, const std::string& name) {
+            fmt::print(
+                file,
+                "{}\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                "\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                first ? "" : ",", tid, name
+            );
+            first = false;
+        };
+
+        fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+        std::lock_guard lock(mutex);
+        threadName(0, "ticks");
+        for (const Span& span : ticks) {
+            event(span, 0);
+        }
+        for (const auto& thread : threads) {
+            std::lock_guard threadLock(thread->mutex);
+            threadName(thread->tid, fmt::format("thread {}", thread->tid));
+            for (const Span& span : thread->spans) {
+                event(span, thread->tid);
+            }
+        }
+        fmt::print(file, "\n]}}\n");
+        const bool ok = std::ferror(file) == 0;
+        std::fclose(file);
+        return ok;
+    }
+
+   private:
+    struct ThreadProfile {
+        int                                               tid;
+        std::mutex                                        mutex;
+        std::vector<Span>                                 spans;
+        size_t                                            next = 0;
+        std::unordered_map<const char*, RollingHistogram> histograms;
+    };
+
+    const ProfileTime epoch = now();
+
+    std::mutex                                  mutex;  // threads and ticks
+    std::vector<std::unique_ptr<ThreadProfile>> threads;
+    std::vector<Span>                           ticks;
+    size_t                                      nextTick = 0;
+    RollingHistogram                            tickHistogram;
+    std::atomic<int>                            currentTick = 0;
+    ProfileTime                                 tickStart   = epoch;
+
+    ThreadProfile* registerThread() {
+        std::lock_guard lock(mutex);
+        auto            thread = std::make_unique<ThreadProfile>();
+        thread->tid            = static_cast<int>(threads.size()) + 1;
+        threads.push_back(std::move(thread));
+        return threads.back().get();
+    }
+
+    // Append to a ring of at most `capacity` spans
+    static void push(
+        std::vector<Span>& ring, size_t& next, const Span& span, size_t capacity
+    ) {
+        if (ring.size() < capacity) {
+            ring.push_back(span);
+        } else {
+            ring[next] = span;
+        }
+        next = (next + 1) % capacity;
+    }
+};
+
+Profiler profiler;
+
+class ScopedTimer {
+   public:
+    explicit ScopedTimer(const char* name)
+        : name(name)
+        , start(now()) {}
+
+    ~ScopedTimer() {
+        profiler.record(name, start, now());
+    }
+
+    ScopedTimer(const ScopedTimer&)            = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+   private:
+    const char* name;
+    ProfileTime start;
+};
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b)  PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) \
+    ScopedTimer PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_FUNCTION()       PROFILE_SCOPE(__func__)
+#define PROFILE_BEGIN_TICK(tick) profiler.beginTick(tick)
+#define PROFILE_END_TICK()       profiler.endTick()
+#else
+#define PROFILE_SCOPE(name)      ((void)0)
+#define PROFILE_FUNCTION()       ((void)0)
+#define PROFILE_BEGIN_TICK(tick) ((void)0)
+#define PROFILE_END_TICK()       ((void)0)
+#endif
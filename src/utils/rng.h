@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+
+// SplitMix64 finalizer: a well mixed 64-bit value from any input
+uint64_t mix64(uint64_t z) {
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+// Order-dependent hash of `value` onto `seed`
+uint64_t hashCombine(uint64_t seed, uint64_t value) {
+    return mix64(seed ^ (mix64(value) + 0x9e3779b97f4a7c15ull));
+}
+
+// Small seeded generator (SplitMix64). A stream is a pure function of its
+// seed, and `split` derives an independent child stream from a key without
+// advancing the parent, so each system, entity or tick can draw from its own
+// stream in any order and still get the same numbers.
+//
+// Draws go through `below` and `unit` rather than the std distributions,
+// whose output differs between standard libraries, so a seed gives the same
+// world on every platform.
+class Rng {
+   public:
+    using result_type = uint64_t;
+
+    explicit Rng(uint64_t seed = 0)
+        : state(seed) {}
+
+    static constexpr result_type min() {
+        return 0;
+    }
+    static constexpr result_type max() {
+        return UINT64_MAX;
+    }
+
+    result_type operator()() {
+        state += GOLDEN;
+        return mix64(state);
+    }
+
+    Rng split(uint64_t key) const {
+        return Rng(hashCombine(state, key));
+    }
+
+    // Uniform in [0, n); `n` must be positive
+    uint64_t below(uint64_t n) {
+        // Reject the low values that would make the modulo uneven
+        const uint64_t threshold = (0 - n) % n;
+        while (true) {
+            const uint64_t r = (*this)();
+            if (r >= threshold) {
+                return r % n;
+            }
+        }
+    }
+
+    // Uniform in [0, 1)
+    double unit() {
+        return static_cast<double>((*this)() >> 11) * 0x1.0p-53;
+    }
+
+   private:
+    static constexpr uint64_t GOLDEN = 0x9e3779b97f4a7c15ull;
+
+    uint64_t state;
+};
@@ -0,0 +1,97 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Hierarchical timer wheel over integer ticks. Level 0 has a slot per tick
+// for the next 64 ticks, level 1 a slot per 64 ticks, and so on. Timers are
+// filed by the highest tick digit in which they differ from now, and move
+// down a level each time the wheel turns past their slot, so scheduling is
+// O(1) and advancing one tick touches only the timers due or moving.
+template <typename T>
+class TimerWheel {
+   public:
+    struct Timer {
+        uint64_t deadline;
+        T        item;
+    };
+
+    uint64_t now() const {
+        return current;
+    }
+
+    size_t size() const {
+        return count;
+    }
+
+    // Timers already due fire on the next advance
+    void schedule(uint64_t deadline, T item) {
+        count += 1;
+        file({std::max(deadline, current + 1), item});
+    }
+
+    // Step to tick `to`, appending every timer due by then to `due`
+    void advance(uint64_t to, std::vector<Timer>& due) {
+        while (current < to) {
+            current += 1;
+            // Higher levels wrap first, so cascaded timers land below
+            for (int level = LEVELS - 1; level > 0; --level) {
+                const uint64_t span = uint64_t(1) << (level * SLOT_BITS);
+                if (current % span == 0) {
+                    cascade(level, slotOf(current, level));
+                }
+            }
+            if (current % (uint64_t(1) << (LEVELS * SLOT_BITS)) == 0) {
+                std::vector<Timer> later;
+                later.swap(overflow);
+                for (const Timer& timer : later) {
+                    file(timer);
+                }
+            }
+
+            std::vector<Timer>& slot = slots[0][slotOf(current, 0)];
+            count -= slot.size();
+            due.insert(due.end(), slot.begin(), slot.end());
+            slot.clear();
+        }
+    }
+
+   private:
+    static constexpr int SLOT_BITS = 6;
+    static constexpr int SLOTS     = 1 << SLOT_BITS;
+    static constexpr int LEVELS    = 4;
+
+    std::array<std::array<std::vector<Timer>, SLOTS>, LEVELS> slots;
+    std::vector<Timer> overflow;  // past the top level's range
+    uint64_t           current = 0;
+    size_t             count   = 0;
+
+    static int slotOf(uint64_t tick, int level) {
+        return static_cast<int>((tick >> (level * SLOT_BITS)) & (SLOTS - 1));
+    }
+
+    // `timer.deadline` is after `current`
+    void file(const Timer& timer) {
+        // Highest base-64 digit in which the deadline differs from now
+        const uint64_t differ = timer.deadline ^ current;
+        const int      bits   = static_cast<int>(std::bit_width(differ));
+        const int      level  = std::max(bits - 1, 0) / SLOT_BITS;
+        if (level >= LEVELS) {
+            overflow.push_back(timer);
+            return;
+        }
+        slots[level][slotOf(timer.deadline, level)].push_back(timer);
+    }
+
+    void cascade(int level, int slot) {
+        std::vector<Timer> moving;
+        moving.swap(slots[level][slot]);
+        for (const Timer& timer : moving) {
+            file(timer);
+        }
+    }
+};
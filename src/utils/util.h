@@ -2,11 +2,15 @@
 
 #include <flecs.h>
 
+#include <chrono>
 #include <iostream>
 #include <sstream>
+#include <variant>
 
+#ifndef HEADLESS
 #include "layered_drawer.h"
 #include "text.h"
+#endif
 #include "vectors.h"
 #include "newtype.h"
 
@@ -62,9 +66,8 @@ operator|(std::variant<Ts...> const& v, match<Fs...> const& match) {
 /**** Bad Globals ****/
 /*********************/
 
+#ifndef HEADLESS
 TextDrawer    textDrawer("./open-sans/OpenSans-Bold.ttf");
 LayeredDrawer debugDrawer(1);
 const int     SIM_DEBUG_LAYER = 0;
-
-std::random_device rd;         // Seed
-std::mt19937       gen(rd());  // Mersenne Twister engine
\ No newline at end of file
+#endif
\ No newline at end of file
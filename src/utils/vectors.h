@@ -3,8 +3,12 @@
 #include <fmt/core.h>
 #include <fmt/ostream.h>
 
-#include <SFML/Graphics.hpp>
-#include <random>
+#include <SFML/System/Vector2.hpp>
+#include <cmath>
+#include <iomanip>
+#include <ostream>
+
+#include "rng.h"
 
 using Vec2I = sf::Vector2i;
 using Vec2U = sf::Vector2u;
@@ -51,15 +55,13 @@ Vec2 normalize(const Vec2& v) {
     return {v.x / mag, v.y / mag};
 }
 
-float randomFloat(float min, float max) {
-    static std::default_random_engine     engine;  // Default random engine
-    std::uniform_real_distribution<float> dist(min, max);
-    return dist(engine);
+float randomFloat(Rng& rng, float min, float max) {
+    return min + static_cast<float>(rng.unit()) * (max - min);
 }
 
 // Function to generate a random Vec2 within the given range
-Vec2 randomVector2f(float minX, float maxX, float minY, float maxY) {
-    return {randomFloat(minX, maxX), randomFloat(minY, maxY)};
+Vec2 randomVector2f(Rng& rng, float minX, float maxX, float minY, float maxY) {
+    return {randomFloat(rng, minX, maxX), randomFloat(rng, minY, maxY)};
 }
 
 Vec2 lerp(const Vec2& a, const Vec2& b, float t) {
@@ -3,26 +3,33 @@
 #include <flecs.h>
 
 #include "components.h"
+#include "queries.h"
+#include "utils/profiler.h"
 #include "utils/util.h"
 
-void renderWorkers(flecs::world& ecs, const Tilemap& map) {
-    ecs.each([&map](WorkerTag, Position& pos) {
-        auto worldPos = map.tileToWorld(pos);
+#ifndef HEADLESS
+void renderWorkers(const Queries& queries, const Tilemap& map) {
+    PROFILE_FUNCTION();
+    queries.walkWorkers([&map](flecs::iter& it, const Position* pos) {
+        for (auto i : it) {
+            auto worldPos = map.tileToWorld(pos[i]);
 
-        textDrawer.draw(
-            {.pos = worldPos, .size = 20, .color = sf::Color(20, 20, 20)}, "W"
-        );
+            textDrawer.draw(
+                {.pos = worldPos, .size = 20, .color = sf::Color(20, 20, 20)},
+                "W"
+            );
+        }
     });
 }
+#endif
 
-void spawnWorkers(flecs::world& ecs, int count, Tilemap map) {
-    auto dist_w = std::uniform_int_distribution<int>(0, map.dim.x - 1);
-    auto dist_h = std::uniform_int_distribution<int>(0, map.dim.y - 1);
-
+void spawnWorkers(
+    flecs::world& ecs, int count, const Tilemap& map, Rng& rng
+) {
     for (int i = 0; i < count; i++) {
         flecs::entity e = ecs.entity();
         e.add<WorkerTag>();
-        e.set<Position>(randomTile(Tilemap::Grass, map));
-        e.set<GatherWoodBehavior>({.state = Idle{}, .hasWood = false});
+        e.set<Position>(randomTile(Tilemap::Grass, map, rng));
+        e.add<Idle>();
     }
 }